@@ -1,7 +1,7 @@
 section .data
     constant dd 1000.0        ; Equivalent to const float constant = 1000
-    screen_width dd 1280.0    ; Assuming SCREEN_WIDTH is 1280
-    screen_height dd 720.0    ; Assuming SCREEN_HEIGHT is 720
+    screen_width dd 1280.0    ; SCREEN_WIDTH is 1280, as in kernels.h
+    screen_height dd 800.0    ; SCREEN_HEIGHT is 800, as in kernels.h
     min_norm dd 25.0         ; Minimum norm threshold
     zero dd 0.0              ; For returning 0
     two dd 2.0              ; For division by 2
@@ -14,7 +14,7 @@ section .text
         
         ; Convert integer inputs to float
         cvtsi2ss xmm0, edi     ; positionX to float
-        cvtsi2ss xmm1, rsi     ; positionY to float
+        cvtsi2ss xmm1, esi     ; positionY to float
         
         ; Calculate and subtract SCREEN_WIDTH/2 and SCREEN_HEIGHT/2
         movss xmm2, [rel screen_width]
@@ -0,0 +1,190 @@
+section .data
+    align 32
+    constant times 8 dd 1000.0       ; Same constants as C.s, broadcast to every lane
+    half_width times 8 dd 640.0      ; SCREEN_WIDTH / 2
+    half_height times 8 dd 400.0     ; SCREEN_HEIGHT / 2
+    min_norm times 8 dd 25.0         ; Minimum norm threshold
+
+section .text
+    global C_batch
+    global C_batch_avx2
+    global C_batch_avx512
+    C_batch: ; CurveBatch(rdi -> const int *positionX, rsi -> const int *positionY, rdx -> float *out, rcx -> size_t n), 4 lanes (SSE2)
+        push rbp
+        mov rbp, rsp
+
+        ; Constants stay in registers for the whole batch
+        movaps xmm4, [rel half_width]
+        movaps xmm5, [rel half_height]
+        movaps xmm6, [rel constant]
+        movaps xmm7, [rel min_norm]
+
+        xor rax, rax              ; rax = index
+        mov r8, rcx
+        and r8, -4                ; r8 = n rounded down to a multiple of 4
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        movdqu xmm0, [rdi + rax*4]
+        cvtdq2ps xmm0, xmm0       ; positionX to float
+        subps xmm0, xmm4          ; positionX -= SCREEN_WIDTH/2
+        movdqu xmm1, [rsi + rax*4]
+        cvtdq2ps xmm1, xmm1       ; positionY to float
+        subps xmm1, xmm5          ; positionY -= SCREEN_HEIGHT/2
+
+        mulps xmm0, xmm0          ; positionX * positionX
+        movaps xmm2, xmm1
+        mulps xmm2, xmm1          ; positionY * positionY
+        addps xmm2, xmm0          ; norm = x^2 + y^2
+
+        movaps xmm3, xmm2
+        cmpnltps xmm3, xmm7       ; mask = norm >= 25, replaces the branch of C
+
+        mulps xmm1, xmm6          ; constant * positionY
+        divps xmm1, xmm2          ; Divide by norm (inf/nan lanes are masked out)
+        andps xmm1, xmm3          ; Blend with 0 where norm < 25
+        movups [rdx + rax*4], xmm1
+        add rax, 4
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        cvtsi2ss xmm0, dword [rdi + rax*4]
+        subss xmm0, xmm4
+        cvtsi2ss xmm1, dword [rsi + rax*4]
+        subss xmm1, xmm5
+        mulss xmm0, xmm0
+        movss xmm2, xmm1
+        mulss xmm2, xmm1
+        addss xmm2, xmm0
+        movss xmm3, xmm2
+        cmpnltss xmm3, xmm7
+        mulss xmm1, xmm6
+        divss xmm1, xmm2
+        andps xmm1, xmm3
+        movss [rdx + rax*4], xmm1
+        inc rax
+        jmp .tail
+
+    .end:
+        leave
+        ret
+
+    C_batch_avx2: ; CurveBatch(rdi -> const int *positionX, rsi -> const int *positionY, rdx -> float *out, rcx -> size_t n), 8 lanes (AVX2)
+        push rbp
+        mov rbp, rsp
+
+        ; Constants stay in registers for the whole batch
+        vmovaps ymm4, [rel half_width]
+        vmovaps ymm5, [rel half_height]
+        vmovaps ymm6, [rel constant]
+        vmovaps ymm7, [rel min_norm]
+
+        xor rax, rax              ; rax = index
+        mov r8, rcx
+        and r8, -8                ; r8 = n rounded down to a multiple of 8
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        vcvtdq2ps ymm0, [rdi + rax*4]     ; positionX to float
+        vsubps ymm0, ymm0, ymm4           ; positionX -= SCREEN_WIDTH/2
+        vcvtdq2ps ymm1, [rsi + rax*4]     ; positionY to float
+        vsubps ymm1, ymm1, ymm5           ; positionY -= SCREEN_HEIGHT/2
+
+        vmulps ymm0, ymm0, ymm0           ; positionX * positionX
+        vmulps ymm2, ymm1, ymm1           ; positionY * positionY
+        vaddps ymm2, ymm2, ymm0           ; norm = x^2 + y^2
+
+        vcmpnltps ymm3, ymm2, ymm7        ; mask = norm >= 25
+
+        vmulps ymm1, ymm1, ymm6           ; constant * positionY
+        vdivps ymm1, ymm1, ymm2           ; Divide by norm
+        vandps ymm1, ymm1, ymm3           ; Blend with 0 where norm < 25
+        vmovups [rdx + rax*4], ymm1
+        add rax, 8
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        vcvtsi2ss xmm0, xmm0, dword [rdi + rax*4]
+        vsubss xmm0, xmm0, xmm4
+        vcvtsi2ss xmm1, xmm1, dword [rsi + rax*4]
+        vsubss xmm1, xmm1, xmm5
+        vmulss xmm0, xmm0, xmm0
+        vmulss xmm2, xmm1, xmm1
+        vaddss xmm2, xmm2, xmm0
+        vcmpnltss xmm3, xmm2, xmm7
+        vmulss xmm1, xmm1, xmm6
+        vdivss xmm1, xmm1, xmm2
+        vandps xmm1, xmm1, xmm3
+        vmovss [rdx + rax*4], xmm1
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+    C_batch_avx512: ; CurveBatch(rdi -> const int *positionX, rsi -> const int *positionY, rdx -> float *out, rcx -> size_t n), 16 lanes (AVX-512F)
+        push rbp
+        mov rbp, rsp
+
+        ; Constants stay in registers for the whole batch
+        vbroadcastss zmm4, dword [rel half_width]
+        vbroadcastss zmm5, dword [rel half_height]
+        vbroadcastss zmm6, dword [rel constant]
+        vbroadcastss zmm7, dword [rel min_norm]
+
+        xor rax, rax              ; rax = index
+        mov r8, rcx
+        and r8, -16               ; r8 = n rounded down to a multiple of 16
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        vcvtdq2ps zmm0, [rdi + rax*4]     ; positionX to float
+        vsubps zmm0, zmm0, zmm4           ; positionX -= SCREEN_WIDTH/2
+        vcvtdq2ps zmm1, [rsi + rax*4]     ; positionY to float
+        vsubps zmm1, zmm1, zmm5           ; positionY -= SCREEN_HEIGHT/2
+
+        vmulps zmm0, zmm0, zmm0           ; positionX * positionX
+        vmulps zmm2, zmm1, zmm1           ; positionY * positionY
+        vaddps zmm2, zmm2, zmm0           ; norm = x^2 + y^2
+
+        vcmpps k1, zmm2, zmm7, 5          ; k1 = norm >= 25 (not less than)
+
+        vmulps zmm1, zmm1, zmm6           ; constant * positionY
+        vdivps zmm1{k1}{z}, zmm1, zmm2    ; Divide by norm, 0 where norm < 25
+        vmovups [rdx + rax*4], zmm1
+        add rax, 16
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        vcvtsi2ss xmm0, xmm0, dword [rdi + rax*4]
+        vsubss xmm0, xmm0, xmm4
+        vcvtsi2ss xmm1, xmm1, dword [rsi + rax*4]
+        vsubss xmm1, xmm1, xmm5
+        vmulss xmm0, xmm0, xmm0
+        vmulss xmm2, xmm1, xmm1
+        vaddss xmm2, xmm2, xmm0
+        vcmpnltss xmm3, xmm2, xmm7
+        vmulss xmm1, xmm1, xmm6
+        vdivss xmm1, xmm1, xmm2
+        vandps xmm1, xmm1, xmm3
+        vmovss [rdx + rax*4], xmm1
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+section	.note.GNU-stack
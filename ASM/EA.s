@@ -12,8 +12,8 @@ section .text
         addss xmm0, xmm1      ; Add scalar single-precision float values
         
         ; Calculate PI/3
-        movss xmm2, [PI]      ; Load PI (32-bit float)
-        movss xmm3, [THREE]   ; Load 3.0 into xmm3
+        movss xmm2, [rel PI]    ; Load PI (32-bit float)
+        movss xmm3, [rel THREE] ; Load 3.0 into xmm3
         divss xmm2, xmm3      ; PI/3
         
         ; Add PI/3 to the previous sum
@@ -1,28 +1,26 @@
 section .text
+    extern SINCOS_ps
     global EX
     EX:  ; EndX(xmm0 -> float positionX, xmm1 -> float radius, xmm2 -> float startAngle)
         push rbp
         mov rbp, rsp
-        sub rsp, 8        ; Reserve space for local variables
-        
-        ; Store positionX temporarily
-        movss [rsp], xmm0
-        
-        ; Convert startAngle (xmm2) to x87 for FCOS
-        movss [rsp+4], xmm2
-        fld dword [rsp+4]         ; Load angle to FPU stack
-        fcos                      ; Calculate cosine instead of sine
-        fstp dword [rsp+4]        ; Store result back
-        movss xmm0, [rsp+4]       ; Load cosine result to XMM register
-        
-        ; Multiply by radius (xmm1)
-        mulss xmm0, xmm1
-        
+
+        ; SINCOS_ps only clobbers xmm0-xmm7, keep the arguments in xmm8/xmm9
+        movaps xmm8, xmm0         ; positionX
+        movaps xmm9, xmm1         ; radius
+
+        movd eax, xmm2
+        movd xmm0, eax            ; startAngle alone in lane 0
+        call SINCOS_ps            ; xmm1 = cos(startAngle)
+
+        ; Multiply by radius
+        mulss xmm1, xmm9
+
         ; Add positionX
-        addss xmm0, [rsp]
-        
-        add rsp, 8                ; Restore stack
+        addss xmm1, xmm8
+        movaps xmm0, xmm1
+
         leave
         ret
 
-section	.note.GNU-stack
\ No newline at end of file
+section	.note.GNU-stack
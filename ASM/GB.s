@@ -0,0 +1,61 @@
+section .data
+    align 16
+    rgb_mask times 4 dd 0x00FFFFFF    ; Every byte but alpha
+
+section .text
+    global G_rgba_batch
+    G_rgba_batch: ; GradientBatch(rdi -> RGBA8 color, rsi -> const float *radius, rdx -> unsigned *out, rcx -> size_t n, xmm0 -> outer radius, xmm1 -> scale), 4 rings (SSE2)
+        ; out[k] = color with r, g, b raised by (outer - radius[k]) * scale, saturating; alpha is kept
+        push rbp
+        mov rbp, rsp
+
+        movd xmm2, edi
+        pshufd xmm2, xmm2, 0          ; Base color in every lane
+        shufps xmm0, xmm0, 0          ; Outer radius in every lane
+        shufps xmm1, xmm1, 0          ; Scale in every lane
+        movdqa xmm3, [rel rgb_mask]
+        xor rax, rax                  ; rax = index
+        mov r8, rcx
+        and r8, -4                    ; r8 = n rounded down to a multiple of 4
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        movups xmm4, [rsi + rax*4]    ; 4 radii
+        movaps xmm5, xmm0
+        subps xmm5, xmm4
+        mulps xmm5, xmm1              ; (outer - radius) * scale
+        cvttps2dq xmm5, xmm5          ; Truncated, like G
+        packssdw xmm5, xmm5           ; dword -> word, saturating
+        packuswb xmm5, xmm5           ; word -> byte, negative -> 0, above 255 -> 255
+        punpcklbw xmm5, xmm5
+        punpcklwd xmm5, xmm5          ; Every offset repeated over the 4 bytes of its ring
+        pand xmm5, xmm3               ; Nothing added to alpha
+        paddusb xmm5, xmm2            ; color + offset, saturating at 255
+        movdqu [rdx + rax*4], xmm5
+        add rax, 4
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        movss xmm4, [rsi + rax*4]     ; Same steps on lane 0 only
+        movaps xmm5, xmm0
+        subss xmm5, xmm4
+        mulss xmm5, xmm1
+        cvttps2dq xmm5, xmm5
+        packssdw xmm5, xmm5
+        packuswb xmm5, xmm5
+        punpcklbw xmm5, xmm5
+        punpcklwd xmm5, xmm5
+        pand xmm5, xmm3
+        paddusb xmm5, xmm2
+        movd [rdx + rax*4], xmm5
+        inc rax
+        jmp .tail
+
+    .end:
+        leave
+        ret
+
+section	.note.GNU-stack
@@ -0,0 +1,105 @@
+section .data
+    align 32
+    FPS times 8 dd 60.0    ; FPS broadcast to every lane
+
+section .text
+    global R_batch
+    global R_batch_avx2
+    global R_batch_avx512
+    R_batch: ; RegularBatch(rdi -> const int *velocity, rsi -> float *out, rdx -> size_t n), 4 lanes (SSE2)
+        push rbp
+        mov rbp, rsp
+
+        movaps xmm1, [rel FPS]    ; Load FPS once for the whole batch
+        xor rax, rax              ; rax = index
+        mov rcx, rdx
+        and rcx, -4               ; rcx = n rounded down to a multiple of 4
+
+    .vector:
+        cmp rax, rcx
+        jae .tail
+        movdqu xmm0, [rdi + rax*4]    ; 4 velocities
+        cvtdq2ps xmm0, xmm0           ; Convert them to float
+        divps xmm0, xmm1              ; velocity / FPS, same rounding as R
+        movups [rsi + rax*4], xmm0
+        add rax, 4
+        jmp .vector
+
+    .tail:
+        cmp rax, rdx
+        jae .end
+        cvtsi2ss xmm0, dword [rdi + rax*4]
+        divss xmm0, xmm1
+        movss [rsi + rax*4], xmm0
+        inc rax
+        jmp .tail
+
+    .end:
+        leave
+        ret
+
+    R_batch_avx2: ; RegularBatch(rdi -> const int *velocity, rsi -> float *out, rdx -> size_t n), 8 lanes (AVX2)
+        push rbp
+        mov rbp, rsp
+
+        vmovaps ymm1, [rel FPS]   ; Load FPS once for the whole batch
+        xor rax, rax              ; rax = index
+        mov rcx, rdx
+        and rcx, -8               ; rcx = n rounded down to a multiple of 8
+
+    .vector:
+        cmp rax, rcx
+        jae .tail
+        vcvtdq2ps ymm0, [rdi + rax*4]    ; 8 velocities to float
+        vdivps ymm0, ymm0, ymm1          ; velocity / FPS
+        vmovups [rsi + rax*4], ymm0
+        add rax, 8
+        jmp .vector
+
+    .tail:
+        cmp rax, rdx
+        jae .end
+        vcvtsi2ss xmm0, xmm0, dword [rdi + rax*4]
+        vdivss xmm0, xmm0, xmm1
+        vmovss [rsi + rax*4], xmm0
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+    R_batch_avx512: ; RegularBatch(rdi -> const int *velocity, rsi -> float *out, rdx -> size_t n), 16 lanes (AVX-512F)
+        push rbp
+        mov rbp, rsp
+
+        vbroadcastss zmm1, dword [rel FPS]    ; Load FPS once for the whole batch
+        xor rax, rax              ; rax = index
+        mov rcx, rdx
+        and rcx, -16              ; rcx = n rounded down to a multiple of 16
+
+    .vector:
+        cmp rax, rcx
+        jae .tail
+        vcvtdq2ps zmm0, [rdi + rax*4]    ; 16 velocities to float
+        vdivps zmm0, zmm0, zmm1          ; velocity / FPS
+        vmovups [rsi + rax*4], zmm0
+        add rax, 16
+        jmp .vector
+
+    .tail:
+        cmp rax, rdx
+        jae .end
+        vcvtsi2ss xmm0, xmm0, dword [rdi + rax*4]
+        vdivss xmm0, xmm0, xmm1
+        vmovss [rsi + rax*4], xmm0
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+section	.note.GNU-stack
@@ -0,0 +1,143 @@
+section .data
+    align 64
+    FPS times 16 dd 60.0           ; FPS broadcast to every lane
+    frequency times 16 dd 0.05     ; Same frequency as S.s
+
+section .text
+    extern SINCOS_ps
+    extern SINCOS_ps_avx2
+    extern SINCOS_ps_avx512
+    global S_batch
+    global S_batch_avx2
+    global S_batch_avx512
+    S_batch: ; SinBatch(rdi -> const int *velocity, rsi -> const int *time, rdx -> float *out, rcx -> size_t n), 4 lanes (SSE2)
+        push rbp
+        mov rbp, rsp
+
+        movaps xmm9, [rel FPS]         ; Constants stay in xmm8+, SINCOS_ps keeps them
+        movaps xmm10, [rel frequency]
+
+        xor rax, rax                   ; rax = index
+        mov r8, rcx
+        and r8, -4                     ; r8 = n rounded down to a multiple of 4
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        movdqu xmm0, [rsi + rax*4]
+        cvtdq2ps xmm0, xmm0            ; time to float
+        mulps xmm0, xmm10              ; angle = frequency * time
+        call SINCOS_ps                 ; xmm0 = sin(angle)
+        movdqu xmm8, [rdi + rax*4]
+        cvtdq2ps xmm8, xmm8            ; velocity to float
+        divps xmm8, xmm9               ; baseMovement = velocity / FPS
+        mulps xmm0, xmm8
+        movups [rdx + rax*4], xmm0
+        add rax, 4
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        pxor xmm0, xmm0
+        cvtsi2ss xmm0, dword [rsi + rax*4]
+        mulss xmm0, xmm10
+        call SINCOS_ps
+        cvtsi2ss xmm8, dword [rdi + rax*4]
+        divss xmm8, xmm9
+        mulss xmm0, xmm8
+        movss [rdx + rax*4], xmm0
+        inc rax
+        jmp .tail
+
+    .end:
+        leave
+        ret
+
+    S_batch_avx2: ; SinBatch(rdi -> const int *velocity, rsi -> const int *time, rdx -> float *out, rcx -> size_t n), 8 lanes (AVX2)
+        push rbp
+        mov rbp, rsp
+
+        vmovaps ymm9, [rel FPS]        ; Constants stay in ymm8+, SINCOS_ps_avx2 keeps them
+        vmovaps ymm10, [rel frequency]
+
+        xor rax, rax                   ; rax = index
+        mov r8, rcx
+        and r8, -8                     ; r8 = n rounded down to a multiple of 8
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        vcvtdq2ps ymm0, [rsi + rax*4]  ; time to float
+        vmulps ymm0, ymm0, ymm10       ; angle = frequency * time
+        call SINCOS_ps_avx2            ; ymm0 = sin(angle)
+        vcvtdq2ps ymm8, [rdi + rax*4]  ; velocity to float
+        vdivps ymm8, ymm8, ymm9        ; baseMovement = velocity / FPS
+        vmulps ymm0, ymm0, ymm8
+        vmovups [rdx + rax*4], ymm0
+        add rax, 8
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        vxorps xmm0, xmm0, xmm0
+        vcvtsi2ss xmm0, xmm0, dword [rsi + rax*4]
+        vmulss xmm0, xmm0, xmm10
+        call SINCOS_ps_avx2
+        vcvtsi2ss xmm8, xmm8, dword [rdi + rax*4]
+        vdivss xmm8, xmm8, xmm9
+        vmulss xmm0, xmm0, xmm8
+        vmovss [rdx + rax*4], xmm0
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+    S_batch_avx512: ; SinBatch(rdi -> const int *velocity, rsi -> const int *time, rdx -> float *out, rcx -> size_t n), 16 lanes (AVX-512F)
+        push rbp
+        mov rbp, rsp
+
+        vmovaps zmm9, [rel FPS]        ; Constants stay in zmm8+, SINCOS_ps_avx512 keeps them
+        vmovaps zmm10, [rel frequency]
+
+        xor rax, rax                   ; rax = index
+        mov r8, rcx
+        and r8, -16                    ; r8 = n rounded down to a multiple of 16
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        vcvtdq2ps zmm0, [rsi + rax*4]  ; time to float
+        vmulps zmm0, zmm0, zmm10       ; angle = frequency * time
+        call SINCOS_ps_avx512          ; zmm0 = sin(angle)
+        vcvtdq2ps zmm8, [rdi + rax*4]  ; velocity to float
+        vdivps zmm8, zmm8, zmm9        ; baseMovement = velocity / FPS
+        vmulps zmm0, zmm0, zmm8
+        vmovups [rdx + rax*4], zmm0
+        add rax, 16
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        vxorps xmm0, xmm0, xmm0
+        vcvtsi2ss xmm0, xmm0, dword [rsi + rax*4]
+        vmulss xmm0, xmm0, xmm10
+        call SINCOS_ps_avx512
+        vcvtsi2ss xmm8, xmm8, dword [rdi + rax*4]
+        vdivss xmm8, xmm8, xmm9
+        vmulss xmm0, xmm0, xmm8
+        vmovss [rdx + rax*4], xmm0
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+section	.note.GNU-stack
@@ -0,0 +1,371 @@
+section .data
+    align 64
+    two_over_pi times 16 dd 0.63661977236758134    ; 2/PI, picks the quadrant
+    pio2_1 times 16 dd 1.5703125                   ; PI/2 split in three parts (Cody-Waite)
+    pio2_2 times 16 dd 4.837512969970703125e-4
+    pio2_3 times 16 dd 7.54978995489188216e-8
+    sin_p0 times 16 dd -1.9515295891e-4            ; Minimax sin on [-PI/4, PI/4]
+    sin_p1 times 16 dd 8.3321608736e-3
+    sin_p2 times 16 dd -1.6666654611e-1
+    cos_p0 times 16 dd 2.443315711809948e-5        ; Minimax cos on [-PI/4, PI/4]
+    cos_p1 times 16 dd -1.388731625493765e-3
+    cos_p2 times 16 dd 4.166664568298827e-2
+    half times 16 dd 0.5
+    one times 16 dd 1.0
+    int_one times 16 dd 1
+    int_two times 16 dd 2
+
+section .text
+    global SINCOS
+    global SINCOS_ps
+    global SINCOS_batch
+    global SINCOS_ps_avx2
+    global SINCOS_batch_avx2
+    global SINCOS_ps_avx512
+    global SINCOS_batch_avx512
+    global SINCOS_ps_fma
+    global SINCOS_batch_fma
+
+    SINCOS_ps: ; PackedSinCos(xmm0 -> 4 x float angle) -> xmm0 = sin, xmm1 = cos
+        ; Register-only helper for the other kernels: clobbers xmm0-xmm7 only,
+        ; general purpose registers and the stack are left alone.
+
+        ; Range reduction: q = round(angle * 2/PI), r = angle - q * PI/2
+        movaps xmm1, xmm0
+        mulps xmm1, [rel two_over_pi]
+        cvtps2dq xmm2, xmm1           ; xmm2 = q as int (round to nearest)
+        cvtdq2ps xmm1, xmm2           ; xmm1 = q as float
+        movaps xmm3, xmm1
+        mulps xmm3, [rel pio2_1]
+        subps xmm0, xmm3
+        movaps xmm3, xmm1
+        mulps xmm3, [rel pio2_2]
+        subps xmm0, xmm3
+        mulps xmm1, [rel pio2_3]
+        subps xmm0, xmm1              ; xmm0 = r in [-PI/4, PI/4]
+        movaps xmm4, xmm0
+        mulps xmm4, xmm0              ; xmm4 = z = r * r
+
+        ; sin(r) = ((p0 * z + p1) * z + p2) * z * r + r
+        movaps xmm5, [rel sin_p0]
+        mulps xmm5, xmm4
+        addps xmm5, [rel sin_p1]
+        mulps xmm5, xmm4
+        addps xmm5, [rel sin_p2]
+        mulps xmm5, xmm4
+        mulps xmm5, xmm0
+        addps xmm5, xmm0
+
+        ; cos(r) = ((c0 * z + c1) * z + c2) * z * z - z / 2 + 1
+        movaps xmm6, [rel cos_p0]
+        mulps xmm6, xmm4
+        addps xmm6, [rel cos_p1]
+        mulps xmm6, xmm4
+        addps xmm6, [rel cos_p2]
+        mulps xmm6, xmm4
+        mulps xmm6, xmm4
+        movaps xmm7, [rel half]
+        mulps xmm7, xmm4
+        subps xmm6, xmm7
+        addps xmm6, [rel one]
+
+        ; Odd quadrants swap sin and cos
+        movdqa xmm3, xmm2
+        pand xmm3, [rel int_one]
+        pcmpeqd xmm3, [rel int_one]   ; xmm3 = mask(q is odd)
+        movaps xmm0, xmm3
+        andps xmm0, xmm6
+        movaps xmm1, xmm3
+        andnps xmm1, xmm5
+        orps xmm0, xmm1               ; xmm0 = odd ? cos(r) : sin(r)
+        movaps xmm1, xmm3
+        andps xmm1, xmm5
+        andnps xmm3, xmm6
+        orps xmm1, xmm3               ; xmm1 = odd ? sin(r) : cos(r)
+
+        ; sin is negated when q & 2, cos when (q + 1) & 2
+        movdqa xmm3, xmm2
+        pand xmm3, [rel int_two]
+        pslld xmm3, 30                ; Bit 1 moved to the sign bit
+        xorps xmm0, xmm3
+        paddd xmm2, [rel int_one]
+        pand xmm2, [rel int_two]
+        pslld xmm2, 30
+        xorps xmm1, xmm2
+        ret
+
+    SINCOS: ; SinCos(xmm0 -> float angle, rdi -> float *sine, rsi -> float *cosine)
+        push rbp
+        mov rbp, rsp
+
+        movd eax, xmm0
+        movd xmm0, eax                ; Angle alone in lane 0, other lanes zero
+        call SINCOS_ps
+        movss [rdi], xmm0
+        movss [rsi], xmm1
+
+        leave
+        ret
+
+    SINCOS_batch: ; SinCosBatch(rdi -> const float *angle, rsi -> float *sine, rdx -> float *cosine, rcx -> size_t n), 4 lanes (SSE2)
+        push rbp
+        mov rbp, rsp
+
+        xor rax, rax                  ; rax = index
+        mov r8, rcx
+        and r8, -4                    ; r8 = n rounded down to a multiple of 4
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        movups xmm0, [rdi + rax*4]
+        call SINCOS_ps
+        movups [rsi + rax*4], xmm0
+        movups [rdx + rax*4], xmm1
+        add rax, 4
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        movss xmm0, [rdi + rax*4]     ; Loads from memory zero the other lanes
+        call SINCOS_ps
+        movss [rsi + rax*4], xmm0
+        movss [rdx + rax*4], xmm1
+        inc rax
+        jmp .tail
+
+    .end:
+        leave
+        ret
+
+    SINCOS_ps_avx2: ; PackedSinCos(ymm0 -> 8 x float angle) -> ymm0 = sin, ymm1 = cos
+        ; Same steps and rounding as SINCOS_ps, clobbers ymm0-ymm7 only.
+        vmulps ymm1, ymm0, [rel two_over_pi]
+        vcvtps2dq ymm2, ymm1          ; ymm2 = q as int
+        vcvtdq2ps ymm1, ymm2          ; ymm1 = q as float
+        vmulps ymm3, ymm1, [rel pio2_1]
+        vsubps ymm0, ymm0, ymm3
+        vmulps ymm3, ymm1, [rel pio2_2]
+        vsubps ymm0, ymm0, ymm3
+        vmulps ymm3, ymm1, [rel pio2_3]
+        vsubps ymm0, ymm0, ymm3       ; ymm0 = r
+        vmulps ymm4, ymm0, ymm0       ; ymm4 = z
+
+        vmulps ymm5, ymm4, [rel sin_p0]
+        vaddps ymm5, ymm5, [rel sin_p1]
+        vmulps ymm5, ymm5, ymm4
+        vaddps ymm5, ymm5, [rel sin_p2]
+        vmulps ymm5, ymm5, ymm4
+        vmulps ymm5, ymm5, ymm0
+        vaddps ymm5, ymm5, ymm0       ; ymm5 = sin(r)
+
+        vmulps ymm6, ymm4, [rel cos_p0]
+        vaddps ymm6, ymm6, [rel cos_p1]
+        vmulps ymm6, ymm6, ymm4
+        vaddps ymm6, ymm6, [rel cos_p2]
+        vmulps ymm6, ymm6, ymm4
+        vmulps ymm6, ymm6, ymm4
+        vmulps ymm7, ymm4, [rel half]
+        vsubps ymm6, ymm6, ymm7
+        vaddps ymm6, ymm6, [rel one]  ; ymm6 = cos(r)
+
+        vpand ymm3, ymm2, [rel int_one]
+        vpcmpeqd ymm3, ymm3, [rel int_one]    ; ymm3 = mask(q is odd)
+        vblendvps ymm0, ymm5, ymm6, ymm3      ; odd ? cos(r) : sin(r)
+        vblendvps ymm1, ymm6, ymm5, ymm3      ; odd ? sin(r) : cos(r)
+
+        vpand ymm3, ymm2, [rel int_two]
+        vpslld ymm3, ymm3, 30
+        vxorps ymm0, ymm0, ymm3
+        vpaddd ymm2, ymm2, [rel int_one]
+        vpand ymm2, ymm2, [rel int_two]
+        vpslld ymm2, ymm2, 30
+        vxorps ymm1, ymm1, ymm2
+        ret
+
+    SINCOS_batch_avx2: ; SinCosBatch(rdi -> const float *angle, rsi -> float *sine, rdx -> float *cosine, rcx -> size_t n), 8 lanes (AVX2)
+        push rbp
+        mov rbp, rsp
+
+        xor rax, rax                  ; rax = index
+        mov r8, rcx
+        and r8, -8                    ; r8 = n rounded down to a multiple of 8
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        vmovups ymm0, [rdi + rax*4]
+        call SINCOS_ps_avx2
+        vmovups [rsi + rax*4], ymm0
+        vmovups [rdx + rax*4], ymm1
+        add rax, 8
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        vmovss xmm0, [rdi + rax*4]    ; Zeroes the rest of ymm0
+        call SINCOS_ps_avx2
+        vmovss [rsi + rax*4], xmm0
+        vmovss [rdx + rax*4], xmm1
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+    SINCOS_ps_avx512: ; PackedSinCos(zmm0 -> 16 x float angle) -> zmm0 = sin, zmm1 = cos
+        ; Same steps and rounding as SINCOS_ps, clobbers zmm0-zmm7 and k1 only.
+        vmulps zmm1, zmm0, [rel two_over_pi]
+        vcvtps2dq zmm2, zmm1          ; zmm2 = q as int
+        vcvtdq2ps zmm1, zmm2          ; zmm1 = q as float
+        vmulps zmm3, zmm1, [rel pio2_1]
+        vsubps zmm0, zmm0, zmm3
+        vmulps zmm3, zmm1, [rel pio2_2]
+        vsubps zmm0, zmm0, zmm3
+        vmulps zmm3, zmm1, [rel pio2_3]
+        vsubps zmm0, zmm0, zmm3       ; zmm0 = r
+        vmulps zmm4, zmm0, zmm0       ; zmm4 = z
+
+        vmulps zmm5, zmm4, [rel sin_p0]
+        vaddps zmm5, zmm5, [rel sin_p1]
+        vmulps zmm5, zmm5, zmm4
+        vaddps zmm5, zmm5, [rel sin_p2]
+        vmulps zmm5, zmm5, zmm4
+        vmulps zmm5, zmm5, zmm0
+        vaddps zmm5, zmm5, zmm0       ; zmm5 = sin(r)
+
+        vmulps zmm6, zmm4, [rel cos_p0]
+        vaddps zmm6, zmm6, [rel cos_p1]
+        vmulps zmm6, zmm6, zmm4
+        vaddps zmm6, zmm6, [rel cos_p2]
+        vmulps zmm6, zmm6, zmm4
+        vmulps zmm6, zmm6, zmm4
+        vmulps zmm7, zmm4, [rel half]
+        vsubps zmm6, zmm6, zmm7
+        vaddps zmm6, zmm6, [rel one]  ; zmm6 = cos(r)
+
+        vptestmd k1, zmm2, [rel int_one]      ; k1 = q is odd
+        vblendmps zmm0{k1}, zmm5, zmm6        ; odd ? cos(r) : sin(r)
+        vblendmps zmm1{k1}, zmm6, zmm5        ; odd ? sin(r) : cos(r)
+
+        vpandd zmm3, zmm2, [rel int_two]
+        vpslld zmm3, zmm3, 30
+        vpxord zmm0, zmm0, zmm3
+        vpaddd zmm2, zmm2, [rel int_one]
+        vpandd zmm2, zmm2, [rel int_two]
+        vpslld zmm2, zmm2, 30
+        vpxord zmm1, zmm1, zmm2
+        ret
+
+    SINCOS_batch_avx512: ; SinCosBatch(rdi -> const float *angle, rsi -> float *sine, rdx -> float *cosine, rcx -> size_t n), 16 lanes (AVX-512F)
+        push rbp
+        mov rbp, rsp
+
+        xor rax, rax                  ; rax = index
+        mov r8, rcx
+        and r8, -16                   ; r8 = n rounded down to a multiple of 16
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        vmovups zmm0, [rdi + rax*4]
+        call SINCOS_ps_avx512
+        vmovups [rsi + rax*4], zmm0
+        vmovups [rdx + rax*4], zmm1
+        add rax, 16
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        vmovss xmm0, [rdi + rax*4]    ; Zeroes the rest of zmm0
+        call SINCOS_ps_avx512
+        vmovss [rsi + rax*4], xmm0
+        vmovss [rdx + rax*4], xmm1
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+    SINCOS_ps_fma: ; PackedSinCos(ymm0 -> 8 x float angle) -> ymm0 = sin, ymm1 = cos
+        ; SINCOS_ps_avx2 with fused multiply-adds: fewer instructions and one
+        ; rounding per step, so the last bit can differ from the other
+        ; variants. Only for drawing, never for anything a replay depends on.
+        ; Clobbers ymm0-ymm7 only.
+        vmulps ymm1, ymm0, [rel two_over_pi]
+        vcvtps2dq ymm2, ymm1          ; ymm2 = q as int
+        vcvtdq2ps ymm1, ymm2          ; ymm1 = q as float
+        vfnmadd231ps ymm0, ymm1, [rel pio2_1]    ; r -= q * PI/2, part by part
+        vfnmadd231ps ymm0, ymm1, [rel pio2_2]
+        vfnmadd231ps ymm0, ymm1, [rel pio2_3]    ; ymm0 = r
+        vmulps ymm4, ymm0, ymm0       ; ymm4 = z
+
+        vmovaps ymm5, [rel sin_p0]
+        vfmadd213ps ymm5, ymm4, [rel sin_p1]     ; p0 * z + p1
+        vfmadd213ps ymm5, ymm4, [rel sin_p2]
+        vmulps ymm5, ymm5, ymm4
+        vfmadd213ps ymm5, ymm0, ymm0             ; ymm5 = sin(r)
+
+        vmovaps ymm6, [rel cos_p0]
+        vfmadd213ps ymm6, ymm4, [rel cos_p1]
+        vfmadd213ps ymm6, ymm4, [rel cos_p2]
+        vmulps ymm6, ymm6, ymm4
+        vmulps ymm7, ymm4, [rel half]
+        vfmsub213ps ymm6, ymm4, ymm7             ; c * z * z - z / 2
+        vaddps ymm6, ymm6, [rel one]             ; ymm6 = cos(r)
+
+        vpand ymm3, ymm2, [rel int_one]
+        vpcmpeqd ymm3, ymm3, [rel int_one]    ; ymm3 = mask(q is odd)
+        vblendvps ymm0, ymm5, ymm6, ymm3      ; odd ? cos(r) : sin(r)
+        vblendvps ymm1, ymm6, ymm5, ymm3      ; odd ? sin(r) : cos(r)
+
+        vpand ymm3, ymm2, [rel int_two]
+        vpslld ymm3, ymm3, 30
+        vxorps ymm0, ymm0, ymm3
+        vpaddd ymm2, ymm2, [rel int_one]
+        vpand ymm2, ymm2, [rel int_two]
+        vpslld ymm2, ymm2, 30
+        vxorps ymm1, ymm1, ymm2
+        ret
+
+    SINCOS_batch_fma: ; SinCosBatch(rdi -> const float *angle, rsi -> float *sine, rdx -> float *cosine, rcx -> size_t n), 8 lanes (AVX2 + FMA)
+        push rbp
+        mov rbp, rsp
+
+        xor rax, rax                  ; rax = index
+        mov r8, rcx
+        and r8, -8                    ; r8 = n rounded down to a multiple of 8
+
+    .vector:
+        cmp rax, r8
+        jae .tail
+        vmovups ymm0, [rdi + rax*4]
+        call SINCOS_ps_fma
+        vmovups [rsi + rax*4], ymm0
+        vmovups [rdx + rax*4], ymm1
+        add rax, 8
+        jmp .vector
+
+    .tail:
+        cmp rax, rcx
+        jae .end
+        vmovss xmm0, [rdi + rax*4]    ; Zeroes the rest of ymm0
+        call SINCOS_ps_fma
+        vmovss [rsi + rax*4], xmm0
+        vmovss [rdx + rax*4], xmm1
+        inc rax
+        jmp .tail
+
+    .end:
+        vzeroupper
+        leave
+        ret
+
+section	.note.GNU-stack
@@ -12,8 +12,8 @@ section .text
         cvtsi2ss xmm0, edi     ; Convert input angle to float
         
         ; Calculate: (input * PI) / 3
-        mulss xmm0, [PI]       ; Multiply by PI
-        movss xmm1, [THREE]    ; Load 3.0 into xmm1
+        mulss xmm0, [rel PI]    ; Multiply by PI
+        movss xmm1, [rel THREE] ; Load 3.0 into xmm1
         divss xmm0, xmm1       ; Divide by 3 to get segment angle
         
         leave
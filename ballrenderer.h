@@ -0,0 +1,163 @@
+#ifndef BALLRENDERER_H
+#define BALLRENDERER_H
+
+#include "raylib.h"
+#include "rlgl.h"
+#include "kernels.h"
+#include "profiler.h"
+
+// Draws every ball's pinwheel through one rlgl triangle batch. The six
+// sectors and their spokes are built once as a mesh around the origin, so a
+// ball costs one rotation by its rotation angle and a translation instead of
+// six DrawCircleSector and six DrawLineEx calls. Balls are added between
+// begin() and end() and go out RENDER_CHUNK at a time, with the sines and
+// cosines of a whole chunk from one sincosBatch call.
+
+#define SECTOR_SEGMENTS 4
+#define MESH_VERTICES (6 * SECTOR_SEGMENTS * 3 + 6 * 6)
+#define RENDER_CHUNK 64
+
+//BALL RENDERER CLASS
+class BallRenderer
+{
+private:
+    float meshX[MESH_VERTICES];
+    float meshY[MESH_VERTICES];
+    Color meshColor[MESH_VERTICES];
+    int vertices;
+
+    float positionX[RENDER_CHUNK];
+    float positionY[RENDER_CHUNK];
+    float angle[RENDER_CHUNK];
+    int count;
+
+    float vertexX[RENDER_CHUNK * MESH_VERTICES];
+    float vertexY[RENDER_CHUNK * MESH_VERTICES];
+
+    GameMode *gameMode;
+    Profiler *profiler;
+
+    // Keeps raylib's winding (the one DrawCircleSector uses) so nothing is culled.
+    void addTriangle(float x0, float y0, float x1, float y1, float x2, float y2, Color color)
+    {
+        if ((x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0) > 0)
+        {
+            float swapX = x1;
+            float swapY = y1;
+            x1 = x2;
+            y1 = y2;
+            x2 = swapX;
+            y2 = swapY;
+        }
+        meshX[vertices] = x0;
+        meshY[vertices] = y0;
+        meshColor[vertices++] = color;
+        meshX[vertices] = x1;
+        meshY[vertices] = y1;
+        meshColor[vertices++] = color;
+        meshX[vertices] = x2;
+        meshY[vertices] = y2;
+        meshColor[vertices++] = color;
+    }
+
+    void flush()
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        // Only the transform is timed, the rlgl calls below are not
+        {
+            ScopedTimer timer(profiler, DrawZone);
+
+            float sine[RENDER_CHUNK];
+            float cosine[RENDER_CHUNK];
+            sincosBatch(angle, sine, cosine, count, gameMode);
+
+            for (int b = 0; b < count; b++)
+            {
+                float *outX = vertexX + b * MESH_VERTICES;
+                float *outY = vertexY + b * MESH_VERTICES;
+                for (int v = 0; v < vertices; v++)
+                {
+                    outX[v] = positionX[b] + meshX[v] * cosine[b] - meshY[v] * sine[b];
+                    outY[v] = positionY[b] + meshX[v] * sine[b] + meshY[v] * cosine[b];
+                }
+            }
+        }
+
+        rlCheckRenderBatchLimit(count * vertices);
+        rlBegin(RL_TRIANGLES);
+        for (int b = 0; b < count; b++)
+        {
+            float *outX = vertexX + b * MESH_VERTICES;
+            float *outY = vertexY + b * MESH_VERTICES;
+            for (int v = 0; v < vertices; v++)
+            {
+                rlColor4ub(meshColor[v].r, meshColor[v].g, meshColor[v].b, meshColor[v].a);
+                rlVertex2f(outX[v], outY[v]);
+            }
+        }
+        rlEnd();
+
+        count = 0;
+    }
+
+public:
+    // Sectors alternate between color1 and color2, spokes are color3 and one pixel wide.
+    BallRenderer(float radius, Color color1, Color color2, Color color3)
+        : vertices(0), count(0), gameMode(NULL), profiler(NULL)
+    {
+        float step = PI / 3 / SECTOR_SEGMENTS;
+
+        for (int i = 0; i < 6; i++)
+        {
+            for (int j = 0; j < SECTOR_SEGMENTS; j++)
+            {
+                float start = i * PI / 3 + j * step;
+                addTriangle(0, 0,
+                            radius * cosf(start + step), radius * sinf(start + step),
+                            radius * cosf(start), radius * sinf(start),
+                            i % 2 == 0 ? color1 : color2);
+            }
+        }
+
+        for (int i = 0; i < 6; i++)
+        {
+            float endX = radius * cosf(i * PI / 3);
+            float endY = radius * sinf(i * PI / 3);
+            float normalX = -sinf(i * PI / 3) * 0.5f;
+            float normalY = cosf(i * PI / 3) * 0.5f;
+            addTriangle(normalX, normalY, -normalX, -normalY, endX - normalX, endY - normalY, color3);
+            addTriangle(normalX, normalY, endX - normalX, endY - normalY, endX + normalX, endY + normalY, color3);
+        }
+    }
+
+    void begin(GameMode *gM, Profiler *p)
+    {
+        gameMode = gM;
+        profiler = p;
+        count = 0;
+    }
+
+    // A ball centered at (x, y), turned by rotationAngle radians.
+    void add(float x, float y, float rotationAngle)
+    {
+        positionX[count] = x;
+        positionY[count] = y;
+        angle[count] = rotationAngle;
+        count++;
+        if (count == RENDER_CHUNK)
+        {
+            flush();
+        }
+    }
+
+    void end()
+    {
+        flush();
+    }
+};
+
+#endif
@@ -0,0 +1,576 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "profiler.h"
+#include "random.h"
+#include "kernels.h"
+
+// Headless C++ vs Assembly benchmark of the kernels in kernels.h. Every pair
+// is run over the same seeded inputs after a warmup, and the results are
+// written as CSV or JSON. Batch kernels report per element rather than per
+// call. The pathStep rows time one tick of ball path kernels for every Path
+// and Program, dispatched at runtime and through a template instance. They
+// time the kernel calls alone, kept out of line; in the game the instance
+// is inlined into Simulation::tickAs() with the rest of the tick, which is
+// what headless matches per second measure.
+// Every row names the isa its Assembly kernels were bound for; --isa all
+// runs everything once per isa the CPU has.
+//
+//     ./bench.out [--iterations N] [--warmup N] [--seed N] [--format csv|json] [--isa NAME|all]
+
+#define INPUTS (1 << 16)
+
+//STRUCTURS
+typedef struct Inputs
+{
+    int velocity[INPUTS];
+    int time[INPUTS];
+    int positionX[INPUTS];
+    int positionY[INPUTS];
+    int segment[INPUTS];
+    float rotationAngle[INPUTS];
+    int color[INPUTS];
+    float ring[INPUTS];
+} Inputs;
+
+typedef struct Result
+{
+    const char *kernel;
+    const char *program;
+    const char *isa;
+    long calls;
+    double nanosecondsPerCall;
+    double callsPerSecond;
+    double maxDivergence;
+} Result;
+
+typedef struct Options
+{
+    long iterations;
+    long warmup;
+    unsigned long long seed;
+    bool json;
+    bool allIsas;
+} Options;
+
+Inputs inputs;
+volatile float sink;
+
+void generateInputs(unsigned long long seed)
+{
+    Random random(seed);
+    for (int i = 0; i < INPUTS; i++)
+    {
+        inputs.velocity[i] = random.value(-600, 600);
+        inputs.time[i] = random.value(0, 200000);
+        inputs.positionX[i] = random.value(0, SCREEN_WIDTH);
+        inputs.positionY[i] = random.value(0, SCREEN_HEIGHT);
+        inputs.segment[i] = random.value(0, 5);
+        inputs.rotationAngle[i] = random.value(0, 100000) * 0.1f;
+        inputs.color[i] = random.value(0, 255);
+        inputs.ring[i] = random.uniform(0.1f, 128.0f);
+    }
+}
+
+//KERNELS
+// Each kernel reads input k and writes up to four outputs, returning how many.
+struct RegularKernel
+{
+    static const char *name() { return "regularPath"; }
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        out[0] = regularPath(inputs.velocity[k], gameMode);
+        return 1;
+    }
+};
+
+struct SinKernel
+{
+    static const char *name() { return "sinPath"; }
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        out[0] = sinPath(inputs.velocity[k], inputs.time[k], gameMode);
+        return 1;
+    }
+};
+
+struct CurveKernel
+{
+    static const char *name() { return "curvePath"; }
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        out[0] = curvePath(inputs.positionX[k], inputs.positionY[k], gameMode);
+        return 1;
+    }
+};
+
+struct SegmentKernel
+{
+    static const char *name() { return "ballSegment"; }
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        ballSegment(inputs.segment[k], inputs.rotationAngle[k], inputs.positionX[k], inputs.positionY[k], 10,
+                    gameMode, &out[0], &out[1], &out[2], &out[3]);
+        return 4;
+    }
+};
+
+struct SegmentsKernel
+{
+    static const char *name() { return "ballSegments"; }
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        float startAngle[6];
+        float endAngle[6];
+        float endX[6];
+        float endY[6];
+        ballSegments(inputs.rotationAngle[k], inputs.positionX[k], inputs.positionY[k], 10, gameMode,
+                     startAngle, endAngle, endX, endY);
+        out[0] = endX[0] + endX[5];
+        out[1] = endY[0] + endY[5];
+        out[2] = endX[3];
+        out[3] = endY[3];
+        return 4;
+    }
+};
+
+struct GradientKernel
+{
+    static const char *name() { return "gradient"; }
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        out[0] = gradient(inputs.color[k], inputs.ring[k], gameMode);
+        return 1;
+    }
+};
+
+//BATCH KERNELS
+// Batch kernels process all INPUTS elements per call; calls count elements.
+struct RegularBatchKernel
+{
+    static const char *name() { return "regularPathBatch"; }
+    void operator()(GameMode *gameMode, float *out) const
+    {
+        regularPathBatch(inputs.velocity, out, INPUTS, gameMode);
+    }
+};
+
+struct SinBatchKernel
+{
+    static const char *name() { return "sinPathBatch"; }
+    void operator()(GameMode *gameMode, float *out) const
+    {
+        sinPathBatch(inputs.velocity, inputs.time, out, INPUTS, gameMode);
+    }
+};
+
+struct SinCosBatchKernel
+{
+    static const char *name() { return "sincosBatch"; }
+    void operator()(GameMode *gameMode, float *out) const
+    {
+        // sin lands in out, cos is only written so both halves are timed
+        static float cosine[INPUTS];
+        sincosBatch(inputs.rotationAngle, out, cosine, INPUTS, gameMode);
+    }
+};
+
+struct GradientBatchKernel
+{
+    static const char *name() { return "gradientBatch"; }
+    void operator()(GameMode *gameMode, float *out) const
+    {
+        // Alpha passes through unchanged, so only r, g and b are compared; as
+        // a 24-bit integer they fit a float exactly
+        static unsigned packed[INPUTS];
+        gradientBatch(0xFF000000u | (unsigned)inputs.color[0] * 0x010101u, inputs.ring, packed, INPUTS, 128, 0.5f, gameMode);
+        for (int i = 0; i < INPUTS; i++)
+        {
+            out[i] = (float)(packed[i] & 0xFFFFFF);
+        }
+    }
+};
+
+struct CurveBatchKernel
+{
+    static const char *name() { return "curvePathBatch"; }
+    void operator()(GameMode *gameMode, float *out) const
+    {
+        curvePathBatch(inputs.positionX, inputs.positionY, out, INPUTS, gameMode);
+    }
+};
+
+//PATH STEPS
+// The kernel calls of one Ball::path() tick for input k: x and y
+// displacement and the curve pull. runtimePathStep() dispatches the way
+// Ball::path() used to, switching on gameMode->path with every kernel
+// branching on gameMode->program again; templatePathStep() is the path part
+// of Simulation::tickAs(), compiled for one Path and Program. Both are kept
+// out of line, so only the dispatch and the kernels are timed.
+typedef int (*PathStepFunction)(int k, float *out);
+
+__attribute__((noinline)) int runtimePathStep(int k, GameMode *gameMode, float *out)
+{
+    float curve = 0;
+    switch (gameMode->path)
+    {
+    case Path::Sin:
+        out[0] = regularPath(inputs.velocity[k], gameMode);
+        out[1] = sinPath(inputs.velocity[k ^ 1], inputs.time[k], gameMode);
+        break;
+
+    case Path::Curve:
+        curve = curvePath(inputs.positionX[k], inputs.positionY[k], gameMode);
+        out[0] = regularPath(inputs.velocity[k], gameMode);
+        out[1] = regularPath(inputs.velocity[k ^ 1], gameMode);
+        break;
+
+    default:
+        out[0] = regularPath(inputs.velocity[k], gameMode);
+        out[1] = regularPath(inputs.velocity[k ^ 1], gameMode);
+        break;
+    }
+    out[2] = curve;
+    return 3;
+}
+
+template <Path P, typename Kernels>
+__attribute__((noinline)) int templatePathStep(int k, float *out)
+{
+    float curve = 0;
+    out[0] = Kernels::regularPath(inputs.velocity[k]);
+    if constexpr (P == Path::Sin)
+    {
+        out[1] = Kernels::sinPath(inputs.velocity[k ^ 1], inputs.time[k]);
+    }
+    else
+    {
+        if constexpr (P == Path::Curve)
+        {
+            curve = Kernels::curvePath(inputs.positionX[k], inputs.positionY[k]);
+        }
+        out[1] = Kernels::regularPath(inputs.velocity[k ^ 1]);
+    }
+    out[2] = curve;
+    return 3;
+}
+
+template <typename Kernels>
+PathStepFunction pathStepFor(Path path)
+{
+    switch (path)
+    {
+    case Path::Sin:
+        return templatePathStep<Path::Sin, Kernels>;
+    case Path::Curve:
+        return templatePathStep<Path::Curve, Kernels>;
+    default:
+        return templatePathStep<Path::Regular, Kernels>;
+    }
+}
+
+struct RuntimePathStepKernel
+{
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        return runtimePathStep(k, gameMode, out);
+    }
+};
+
+// Bound once, like Simulation's tick; the gameMode passed per call is ignored.
+struct TemplatePathStepKernel
+{
+    PathStepFunction step;
+    int operator()(int k, GameMode *gameMode, float *out) const
+    {
+        return step(k, out);
+    }
+};
+
+float batchExpected[INPUTS];
+float batchActual[INPUTS];
+
+template <typename Kernel>
+double timeKernel(Kernel kernel, GameMode *gameMode, long iterations)
+{
+    float out[4] = {0, 0, 0, 0};
+    float sum = 0;
+    uint64_t start = nanoseconds();
+    for (long n = 0; n < iterations; n++)
+    {
+        kernel((int)(n & (INPUTS - 1)), gameMode, out);
+        sum += out[0] + out[1] + out[2] + out[3];
+    }
+    uint64_t elapsed = nanoseconds() - start;
+    sink = sum;
+    return (double)elapsed;
+}
+
+template <typename Kernel>
+double divergence(Kernel kernel)
+{
+    GameMode cpp = {1, Path::Regular, Difficulty::Easy, Program::Cpp};
+    GameMode assembly = {1, Path::Regular, Difficulty::Easy, Program::Assembly};
+    double maxDivergence = 0;
+    for (int k = 0; k < INPUTS; k++)
+    {
+        float expected[4];
+        float actual[4];
+        int outputs = kernel(k, &cpp, expected);
+        kernel(k, &assembly, actual);
+        for (int i = 0; i < outputs; i++)
+        {
+            double difference = fabs((double)expected[i] - (double)actual[i]);
+            if (difference > maxDivergence || difference != difference)
+            {
+                maxDivergence = difference;
+            }
+        }
+    }
+    return maxDivergence;
+}
+
+template <typename Kernel>
+int benchmark(Kernel kernel, Options *options, Result *results)
+{
+    double maxDivergence = divergence(kernel);
+    Program programs[2] = {Program::Cpp, Program::Assembly};
+
+    for (int i = 0; i < 2; i++)
+    {
+        GameMode gameMode = {1, Path::Regular, Difficulty::Easy, programs[i]};
+        timeKernel(kernel, &gameMode, options->warmup);
+        double elapsed = timeKernel(kernel, &gameMode, options->iterations);
+
+        results[i].kernel = Kernel::name();
+        results[i].program = programs[i] == Program::Cpp ? "cpp" : "assembly";
+        results[i].calls = options->iterations;
+        results[i].nanosecondsPerCall = elapsed / options->iterations;
+        results[i].callsPerSecond = elapsed > 0 ? options->iterations * 1e9 / elapsed : 0;
+        results[i].maxDivergence = maxDivergence;
+    }
+    return 2;
+}
+
+template <typename Kernel>
+int benchmarkBatch(Kernel kernel, Options *options, Result *results)
+{
+    GameMode cpp = {1, Path::Regular, Difficulty::Easy, Program::Cpp};
+    GameMode assembly = {1, Path::Regular, Difficulty::Easy, Program::Assembly};
+    kernel(&cpp, batchExpected);
+    kernel(&assembly, batchActual);
+    double maxDivergence = 0;
+    for (int k = 0; k < INPUTS; k++)
+    {
+        double difference = fabs((double)batchExpected[k] - (double)batchActual[k]);
+        if (difference > maxDivergence || difference != difference)
+        {
+            maxDivergence = difference;
+        }
+    }
+
+    long batches = (options->iterations + INPUTS - 1) / INPUTS;
+    long warmupBatches = (options->warmup + INPUTS - 1) / INPUTS;
+    GameMode *gameModes[2] = {&cpp, &assembly};
+
+    for (int i = 0; i < 2; i++)
+    {
+        for (long n = 0; n < warmupBatches; n++)
+        {
+            kernel(gameModes[i], batchActual);
+        }
+        uint64_t start = nanoseconds();
+        for (long n = 0; n < batches; n++)
+        {
+            kernel(gameModes[i], batchActual);
+        }
+        double elapsed = (double)(nanoseconds() - start);
+        sink = batchActual[batches & (INPUTS - 1)];
+
+        long calls = batches * INPUTS;
+        results[i].kernel = Kernel::name();
+        results[i].program = gameModes[i]->program == Program::Cpp ? "cpp" : "assembly";
+        results[i].calls = calls;
+        results[i].nanosecondsPerCall = elapsed / calls;
+        results[i].callsPerSecond = elapsed > 0 ? calls * 1e9 / elapsed : 0;
+        results[i].maxDivergence = maxDivergence;
+    }
+    return 2;
+}
+
+// Both dispatches for each of the six Path and Program combinations. The
+// divergence column compares the template step with the runtime one.
+int benchmarkPathSteps(Options *options, Result *results)
+{
+    static const char *names[3][2] = {{"pathStep.regular", "pathStep.regular.template"},
+                                      {"pathStep.sin", "pathStep.sin.template"},
+                                      {"pathStep.curve", "pathStep.curve.template"}};
+    Path paths[3] = {Path::Regular, Path::Sin, Path::Curve};
+    Program programs[2] = {Program::Cpp, Program::Assembly};
+    int count = 0;
+
+    for (int p = 0; p < 3; p++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            GameMode gameMode = {1, paths[p], Difficulty::Easy, programs[i]};
+            RuntimePathStepKernel runtime;
+            TemplatePathStepKernel compiled = {programs[i] == Program::Cpp ? pathStepFor<CppKernels>(paths[p])
+                                                                           : pathStepFor<AssemblyKernels>(paths[p])};
+
+            double maxDivergence = 0;
+            for (int k = 0; k < INPUTS; k++)
+            {
+                float expected[4];
+                float actual[4];
+                int outputs = runtime(k, &gameMode, expected);
+                compiled(k, &gameMode, actual);
+                for (int j = 0; j < outputs; j++)
+                {
+                    double difference = fabs((double)expected[j] - (double)actual[j]);
+                    if (difference > maxDivergence || difference != difference)
+                    {
+                        maxDivergence = difference;
+                    }
+                }
+            }
+
+            timeKernel(runtime, &gameMode, options->warmup);
+            double runtimeElapsed = timeKernel(runtime, &gameMode, options->iterations);
+            timeKernel(compiled, &gameMode, options->warmup);
+            double compiledElapsed = timeKernel(compiled, &gameMode, options->iterations);
+
+            double elapsed[2] = {runtimeElapsed, compiledElapsed};
+            for (int d = 0; d < 2; d++)
+            {
+                results[count].kernel = names[p][d];
+                results[count].program = programs[i] == Program::Cpp ? "cpp" : "assembly";
+                results[count].calls = options->iterations;
+                results[count].nanosecondsPerCall = elapsed[d] / options->iterations;
+                results[count].callsPerSecond = elapsed[d] > 0 ? options->iterations * 1e9 / elapsed[d] : 0;
+                results[count].maxDivergence = maxDivergence;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+void printResults(Options *options, Result *results, int count)
+{
+    if (options->json)
+    {
+        printf("{\"seed\": %llu, \"iterations\": %ld, \"warmup\": %ld, \"results\": [\n",
+               options->seed, options->iterations, options->warmup);
+        for (int i = 0; i < count; i++)
+        {
+            printf("  {\"kernel\": \"%s\", \"program\": \"%s\", \"isa\": \"%s\", \"calls\": %ld, \"ns_per_call\": %.4f, "
+                   "\"calls_per_second\": %.0f, \"max_divergence\": %.9g}%s\n",
+                   results[i].kernel, results[i].program, results[i].isa, results[i].calls, results[i].nanosecondsPerCall,
+                   results[i].callsPerSecond, results[i].maxDivergence, i + 1 < count ? "," : "");
+        }
+        printf("]}\n");
+    }
+    else
+    {
+        printf("kernel,program,isa,calls,ns_per_call,calls_per_second,max_divergence\n");
+        for (int i = 0; i < count; i++)
+        {
+            printf("%s,%s,%s,%ld,%.4f,%.0f,%.9g\n",
+                   results[i].kernel, results[i].program, results[i].isa, results[i].calls, results[i].nanosecondsPerCall,
+                   results[i].callsPerSecond, results[i].maxDivergence);
+        }
+    }
+}
+
+bool parseOptions(int argc, char **argv, Options *options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--iterations") && hasValue)
+        {
+            options->iterations = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--warmup") && hasValue)
+        {
+            options->warmup = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+        {
+            options->seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "--format") && hasValue)
+        {
+            options->json = !strcmp(argv[++i], "json");
+        }
+        else if (!strcmp(argv[i], "--isa") && hasValue)
+        {
+            options->allIsas = !strcmp(argv[++i], "all");
+            if (!options->allIsas && !selectIsa(argv[i]))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--iterations N] [--warmup N] [--seed N] [--format csv|json] "
+                            "[--isa scalar|sse|avx2|fma|avx512|all]\n",
+                    argv[0]);
+            return false;
+        }
+    }
+    return options->iterations > 0 && options->warmup >= 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options options = {10000000, 1000000, 1, false, false};
+    if (!parseOptions(argc, argv, &options))
+    {
+        return 1;
+    }
+
+    generateInputs(options.seed);
+
+    CpuFeatures features = detectCpu();
+    Result results[48 * NumberOfIsas];
+    int count = 0;
+    for (int isa = 0; isa < NumberOfIsas; isa++)
+    {
+        if (options.allIsas)
+        {
+            if (!isaSupported(&features, (Isa)isa))
+            {
+                continue;
+            }
+            useIsa((Isa)isa);
+        }
+        int first = count;
+        count += benchmark(RegularKernel(), &options, results + count);
+        count += benchmark(SinKernel(), &options, results + count);
+        count += benchmark(CurveKernel(), &options, results + count);
+        count += benchmark(SegmentKernel(), &options, results + count);
+        count += benchmark(SegmentsKernel(), &options, results + count);
+        count += benchmark(GradientKernel(), &options, results + count);
+        count += benchmarkBatch(RegularBatchKernel(), &options, results + count);
+        count += benchmarkBatch(SinBatchKernel(), &options, results + count);
+        count += benchmarkBatch(SinCosBatchKernel(), &options, results + count);
+        count += benchmarkBatch(CurveBatchKernel(), &options, results + count);
+        count += benchmarkBatch(GradientBatchKernel(), &options, results + count);
+        count += benchmarkPathSteps(&options, results + count);
+        for (int i = first; i < count; i++)
+        {
+            results[i].isa = isaName(asmKernels.isa);
+        }
+        if (!options.allIsas)
+        {
+            break;
+        }
+    }
+
+    printResults(&options, results, count);
+
+    return 0;
+}
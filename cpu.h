@@ -0,0 +1,132 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cpuid.h>
+
+// Which instruction sets the ASM kernels may use, from CPUID at startup.
+// Every tier includes the ones below it, and each kernel uses its best
+// variant at or below the tier (see kernelTable() in kernels.h). SSE2 is
+// part of x86-64, so IsaSse is always there and IsaScalar, one element per
+// call, only comes from an override. AVX and AVX-512 also need the OS to
+// save their registers, which XGETBV reports. The PONG_ISA environment
+// variable, or --isa in the tools, forces a lower tier, so the variants
+// can be timed against each other on one machine.
+
+//STRUCTURS
+enum Isa
+{
+    IsaScalar,
+    IsaSse,
+    IsaAvx2,
+    IsaFma,
+    IsaAvx512,
+    NumberOfIsas
+};
+
+typedef struct CpuFeatures
+{
+    bool sse41;
+    bool avx2;
+    bool fma;
+    bool avx512;
+} CpuFeatures;
+
+inline const char *isaName(Isa isa)
+{
+    static const char *names[NumberOfIsas] = {"scalar", "sse", "avx2", "fma", "avx512"};
+    return names[isa];
+}
+
+inline bool parseIsa(const char *name, Isa *isa)
+{
+    for (int i = 0; i < NumberOfIsas; i++)
+    {
+        if (!strcmp(name, isaName((Isa)i)))
+        {
+            *isa = (Isa)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline CpuFeatures detectCpu()
+{
+    CpuFeatures features = {false, false, false, false};
+    unsigned a;
+    unsigned b;
+    unsigned c;
+    unsigned d;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+    {
+        return features;
+    }
+    features.sse41 = c & bit_SSE4_1;
+
+    // Which register states the OS saves: bits 1-2 for YMM, 5-7 for ZMM
+    unsigned long long xcr0 = 0;
+    if (c & bit_OSXSAVE)
+    {
+        unsigned low;
+        unsigned high;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        xcr0 = ((unsigned long long)high << 32) | low;
+    }
+    bool avx = (c & bit_AVX) && (xcr0 & 0x06) == 0x06;
+    bool avx512State = (xcr0 & 0xE6) == 0xE6;
+    features.fma = avx && (c & bit_FMA);
+
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d))
+    {
+        features.avx2 = avx && (b & bit_AVX2);
+        features.avx512 = features.avx2 && avx512State && (b & bit_AVX512F);
+    }
+    return features;
+}
+
+inline bool isaSupported(const CpuFeatures *features, Isa isa)
+{
+    switch (isa)
+    {
+    case IsaAvx2:
+        return features->avx2;
+    case IsaFma:
+        return features->avx2 && features->fma;
+    case IsaAvx512:
+        return features->avx512;
+    default:
+        return isa >= IsaScalar && isa < NumberOfIsas;
+    }
+}
+
+inline Isa bestIsa(const CpuFeatures *features)
+{
+    Isa isa = IsaAvx512;
+    while (!isaSupported(features, isa))
+    {
+        isa = (Isa)(isa - 1);
+    }
+    return isa;
+}
+
+// The best tier, or PONG_ISA when it names one this CPU has.
+inline Isa preferredIsa()
+{
+    CpuFeatures features = detectCpu();
+    const char *name = getenv("PONG_ISA");
+    Isa isa;
+    if (name && *name)
+    {
+        if (parseIsa(name, &isa) && isaSupported(&features, isa))
+        {
+            return isa;
+        }
+        fprintf(stderr, "PONG_ISA=%s is not available here, using %s\n", name, isaName(bestIsa(&features)));
+    }
+    return bestIsa(&features);
+}
+
+#endif
@@ -2,7 +2,20 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
-#include <time.h>
+#include "profiler.h"
+#include "kernels.h"
+#include "random.h"
+#include "simulation.h"
+#include "ballrenderer.h"
+#include "rendercache.h"
+#include "replay.h"
+#include "telemetry.h"
+#include "pipeline.h"
+#include "netplay.h"
+#include "uitext.h"
+#include "textrenderer.h"
+#include "menu.h"
+#include "scheduler.h"
 
 #define CHARCOAL {47, 72, 88, 255}
 #define LAPIS_LAZULI {51, 101, 138, 255}
@@ -15,490 +28,88 @@
 #define ASH_GRAY {190, 216, 212, 255}
 #define SEASALT {247, 249, 249, 255}
 
-#define SCREEN_WIDTH 1280
-#define SCREEN_HEIGHT 800
 #define GAME_NAME "PONG"
-#define FPS 60
-
-extern "C" float R(int velocity);
-extern "C" float S(int velocity, int time);
-extern "C" float C(int positionX, int positionY);
-extern "C" int G(int color, float i);
-extern "C" float SE(int i);
-extern "C" float SA(float rotationAngle, float segment);
-extern "C" float EA(float rotationAngle, float segment);
-extern "C" float EX(float positionX, float radius, float startAngle);
-extern "C" float EY(float positionY, float radius, float startAngle);
-
+#define PAUSE_BLINK 0.5
 
 //STRUCTURS
-enum Path
+typedef struct GameOptions
 {
-    Regular,
-    Sin,
-    Curve
-};
-
-enum Difficulty
-{
-    Easy,
-    Meduim,
-    Hard
-};
-
-enum Program
+    int tickRate;
+    int chaosBalls;
+    unsigned long long seed;
+    const char *record;
+    const char *telemetry;
+    int host;
+    const char *connect;
+    NetTuning tuning;
+} GameOptions;
+
+#ifdef PONG_COUNT_ALLOCATIONS
+// Counts every heap allocation in heapAllocations, C++ ones included since
+// operator new goes through malloc, and passes it on to glibc.
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+extern "C" void *malloc(size_t size)
 {
-    Cpp,
-    Assembly
-};
-
-typedef struct GameMode
-{
-    int numberOfPlayer;
-    Path path;
-    Difficulty difficulty;
-    Program program;
-} GameMode;
-
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
 
-//SHAPE CLASS
-class Shape
+extern "C" void *calloc(size_t count, size_t size)
 {
-protected:
-    int positionX;
-    int positionY;
-    Shape(int posX, int posY);
-
-public:
-    int getX();
-    int getY();
-
-
-    Shape(int posX, int posY) : positionX(posX), positionY(posY) {}
-
-    int getX()
-    {
-        return positionX;
-    }
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
 
-    int getY()
-    {
-        return positionY;
-    }
-};
-//RECTANGULARSHAPE CLASS
-class RectangularShape : public Shape
+extern "C" void *realloc(void *pointer, size_t size)
 {
-protected:
-    int width;
-    int height;
-    RectangularShape(int posX, int posY, int wid, int hei);
-
-public:
-    int getWidth();
-    int getHeight();
-    bool checkCollision(Vector2 mousePoint);
-
-    RectangularShape(int posX, int posY, int wid, int hei) : Shape(posX, posY), width(wid), height(hei) {}
-
-    int getWidth()
-    {
-        return width;
-    }
-
-    int getHeight()
-    {
-        return height;
-    }
-
-    bool checkCollision(Vector2 mousePoint)
-    {
-        return CheckCollisionPointRec(mousePoint, Rectangle{(float)positionX, (float)positionY, (float)width, (float)height});
-    }
-};
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+#endif
 
-// PADDLE CLASS
-class Paddle : public RectangularShape
+//PLATFORM
+// Randomness comes from a seeded Random rather than GetRandomValue, so any
+// match can be replayed from its seed and inputs.
+bool raylibKeyDown(void *context, int key)
 {
-protected:
-    int velocityY;
-    int accelerationY;
-    int padding;
-    Color color;
-
-    Paddle(int posX, int posY);
-    void limitCheck();
-
-    Paddle(int posX, int posY)
-        : RectangularShape(posX, posY - 50, 20, 100), velocityY(5), accelerationY(0)
-    {
-        padding = 5;
-        color = HUNYADI_YELLOW;
-    }
+    return IsKeyDown(key);
+}
 
-    void limitCheck()
-    {
-        if (positionY < padding)
-        {
-            positionY = padding;
-        }
-        else if (positionY + height > SCREEN_HEIGHT - padding)
-        {
-            positionY = SCREEN_HEIGHT - height - padding;
-        }
-    }
-};
-// PLAYER CLASS
-class Player
+//RENDERING
+// BeginDrawing for every frame; frameArena text from the frame before is gone.
+void beginDrawing()
 {
-private:
-    int score;
-
-public:
-    Player();
-    void updateScore(int delta);
-    int getScore();
-    char *getName();
-    void setName(char name[20]);
-
-    Player() : score(0)
-    {
-
-    }
-    void updateScore(int delta)
-    {
-        score += delta;
-    }
+    frameArena.reset();
+    BeginDrawing();
+}
 
-    int getScore()
-    {
-        return score;
-    }
-};
-//BALL CLASS
-class Ball : public Shape
+// Draws a simulation snapshot, interpolated alpha of the way into the tick after it.
+void drawBall(const BallState *ball, float spin, float alpha, BallRenderer *renderer)
 {
-private:
-    int velocityX;
-    int velocityY;
-    int accelerationX;
-    int accelerationY;
-    float radius;
-    Color color1;
-    Color color2;
-    Color color3;
-    GameMode gameMode;
-    int round;
-    double *calculationTime;
-
-    void path();
-
-public:
-    Ball(GameMode gM, double *cT)
-        : Shape(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2), gameMode(gM), calculationTime(cT)
-    {
-        choose();
-        round = 0;
-        radius = 10;
-        color1 = STEEL_BLUE;
-        color2 = TIFFANY_BLUE;
-        color3 = SEASALT;
-        reset();
-    }
-
-    Ball(double *cT)
-        : Shape(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2), velocityX(300), velocityY(300), accelerationX(0), accelerationY(0), calculationTime(cT)
-    {
-        int random = GetRandomValue(1, 3);
-        gameMode.path = (random == 1 ? Path::Regular : random == 2 ? Path::Sin
-                                                                : Path::Curve);
-        gameMode.difficulty = Difficulty::Easy;
-        round = 0;
-        radius = 10;
-        color1 = STEEL_BLUE;
-        color2 = TIFFANY_BLUE;
-        color3 = SEASALT;
-        reset();
-    }
-
-    void draw()
-    {
-        float rotationAngle = round * 0.1f;
-
-        double temporaryTime = time(NULL);
-
-        for (int i = 0; i < 6; i++)
-        {
-            float segment;
-            float startAngle;
-            float endAngle;
-            float endX;
-            float endY;
-
-            if (gameMode.program == Program::Cpp)
-            {
-                segment = i * PI / 3;
-                startAngle = rotationAngle + segment;
-                endAngle = rotationAngle + segment + PI / 3;
-                endX = (float)positionX + radius * cos(startAngle);
-                endY = (float)positionY + radius * sin(startAngle);
-            }
-            else
-            {
-                segment = SE(i);
-                startAngle = SA(rotationAngle, segment);
-                endAngle = EA(rotationAngle, segment);
-                endX = EX(positionX, radius, startAngle);
-                endY = EY(positionY, radius, startAngle);
-            }
-
-            Vector2 start = {(float)positionX, (float)positionY};
-            Vector2 end = {endX, endY};
-
-            DrawCircleSector(
-                Vector2{(float)positionX, (float)positionY},
-                radius,
-                startAngle * RAD2DEG,
-                endAngle * RAD2DEG,
-                32,
-                (i % 2 == 0 ? color1 : color2));
-            DrawLineEx(start, end, 1.0f, color3);
-        }
-
-        *calculationTime += time(NULL) - temporaryTime;
-    }
-
-    void update(Player *player1, Player *player2)
-    {
-        path();
-
-        if (positionX - radius <= 0)
-        {
-            player2->updateScore(1);
-            reset();
-        }
-        else if (positionX + radius >= SCREEN_WIDTH)
-        {
-            player1->updateScore(1);
-            reset();
-        }
-        if (positionY - radius <= 0)
-        {
-            positionY = radius;
-            velocityY *= -1;
-        }
-        else if (positionY + radius >= SCREEN_HEIGHT)
-        {
-            positionY = SCREEN_HEIGHT - radius;
-            velocityY *= -1;
-        }
-
-        if (conrner())
-        {
-            reset();
-            choose();
-        }
-    }
-
-    void update()
-    {
-        path();
-
-        if (positionX - radius <= 0)
-        {
-            positionX = radius;
-            velocityX *= -1;
-        }
-        else if (positionX + radius >= SCREEN_WIDTH)
-        {
-            positionX = SCREEN_WIDTH - radius;
-            velocityX *= -1;
-        }
-        if (positionY - radius <= 0)
-        {
-            positionY = radius;
-            velocityY *= -1;
-        }
-        else if (positionY + radius >= SCREEN_HEIGHT)
-        {
-            positionY = SCREEN_HEIGHT - radius;
-            velocityY *= -1;
-        }
-
-        if (conrner())
-        {
-            reset();
-            choose();
-        }
-    }
-
-    void path()
-    {
-        double temporaryTime = time(NULL);
-        velocityX += accelerationX / FPS;
-        velocityY += accelerationY / FPS;
-
-        float deltaX;
-        float deltaY;
-
-        switch (gameMode.path)
-        {
-        case Path::Regular:
-            deltaX = regularPath(velocityX, &gameMode);
-            deltaY = regularPath(velocityY, &gameMode);
-            break;
-
-        case Path::Sin:
-            deltaX = regularPath(velocityX, &gameMode);
-            deltaY = sinPath(velocityY, round, &gameMode);
-            break;
-
-        case Path::Curve:
-            accelerationY += curvePath(positionX, positionY, &gameMode);
-            deltaX = regularPath(velocityX, &gameMode);
-            deltaY = regularPath(velocityY, &gameMode);
-            break;
-
-        default:
-            break;
-        }
-
-        positionX += deltaX;
-        positionY += deltaY;
-        round++;
-
-        *calculationTime += time(NULL) - temporaryTime;
-    }
-
-    void collision(Paddle paddle)
-    {
-        if (CheckCollisionCircleRec(Vector2{(float)positionX, (float)positionY},
-                                    radius,
-                                    Rectangle{(float)paddle.getX(), (float)paddle.getY(), (float)paddle.getWidth(), (float)paddle.getHeight()}))
-        {
-            velocityX *= -1;
-        }
-    }
-
-    void reset()
-    {
-        positionX = SCREEN_WIDTH / 2;
-        positionY = SCREEN_HEIGHT / 2;
-    }
-
-    void choose()
-    {
-        switch (gameMode.difficulty)
-        {
-        case Difficulty::Easy:
-            velocityX = 300;
-            velocityY = 300;
-            accelerationX = 20;
-            accelerationY = 20;
-            break;
-        case Difficulty::Meduim:
-            velocityX = 350;
-            velocityY = 350;
-            accelerationX = 30;
-            accelerationY = 30;
-            break;
-        case Difficulty::Hard:
-            velocityX = 400;
-            velocityY = 400;
-            accelerationX = 40;
-            accelerationY = 40;
-            break;
-        default:
-            break;
-        }
-
-        int random[2] = {-1, 1};
-        velocityX *= random[GetRandomValue(0, 1)];
-        velocityY *= random[GetRandomValue(0, 1)];
-    }
-
-    bool conrner()
-    {
-        return (positionX - radius <= 0 || positionX + radius >= SCREEN_WIDTH) &&
-            (positionY - radius <= 0 || positionY + radius >= SCREEN_HEIGHT);
-    }
+    renderer->add(ball->previousX + (ball->x - ball->previousX) * alpha,
+                  ball->previousY + (ball->y - ball->previousY) * alpha, ball->angle - (1 - alpha) * spin);
+}
 
-};
-//CLASS RUGHT PADDLE
-class RightPaddle : public Paddle
+// Chaos mode balls go through the same batch as the real one.
+void drawBalls(const Snapshot *snapshot, float alpha, BallRenderer *renderer)
 {
-private:
-    bool isAI;
-
-public:
-
-    RightPaddle(int posX, int posY, bool AI)
-        : Paddle(posX, posY), isAI(AI)
-    {
-        positionX -= padding;
-        positionX -= width;
-    }
-
-    void draw()
+    for (int i = 0; i < snapshot->balls; i++)
     {
-        DrawRectangleRounded(Rectangle{(float)positionX, (float)positionY, (float)width, (float)height}, 0.8, 0, color);
+        renderer->add(snapshot->ballsPreviousX[i] + (snapshot->ballsX[i] - snapshot->ballsPreviousX[i]) * alpha,
+                      snapshot->ballsPreviousY[i] + (snapshot->ballsY[i] - snapshot->ballsPreviousY[i]) * alpha,
+                      snapshot->ballsAngle[i] - (1 - alpha) * snapshot->spin);
     }
+}
 
-    void update(Ball ball)
-    {
-        if (isAI && ball.getX() > SCREEN_WIDTH / 2)
-        {
-            if (positionY + height / 2 > ball.getY())
-            {
-                positionY -= velocityY;
-            }
-            else if (positionY + height / 2 < ball.getY())
-            {
-                positionY += velocityY;
-            }
-        }
-        else
-        {
-            if (IsKeyDown(KEY_UP))
-            {
-                positionY -= velocityY;
-            }
-            else if (IsKeyDown(KEY_DOWN))
-            {
-                positionY += velocityY;
-            }
-        }
-        limitCheck();
-    }
-};
-//CLASS LEFT PADDLE
-class LeftPaddle : public Paddle
+void drawPaddle(const PaddleState *paddle, float alpha)
 {
-public:
-    LeftPaddle(int posX, int posY)
-        : Paddle(posX, posY)
-    {
-        positionX += padding;
-    }
-
-    void draw()
-    {
-        DrawRectangleRounded(Rectangle{(float)positionX, (float)positionY, (float)width, (float)height}, 0.8, 0, color);
-    }
-
-    void update()
-    {
-        if (IsKeyDown(KEY_W))
-        {
-            positionY -= velocityY;
-        }
-        else if (IsKeyDown(KEY_S))
-        {
-            positionY += velocityY;
-        }
-        limitCheck();
-    }
-};
+    Color color = HUNYADI_YELLOW;
+    float y = paddle->previousY + (paddle->y - paddle->previousY) * alpha;
+    DrawRectangleRounded(Rectangle{paddle->x, y, paddle->width, paddle->height}, 0.8, 0, color);
+}
 //CLASS CLICKABLE
 class Clickable
 {
@@ -506,11 +117,9 @@ protected:
     bool isFocus;
     Color focus;
     Color normal;
-    Clickable(Color foc, Color nor);
-
-public:
     Clickable(Color foc, Color nor) : isFocus(false), focus(foc), normal(nor) {}
 
+public:
     void toggleFocus()
     {
         isFocus = !isFocus;
@@ -542,7 +151,7 @@ public:
     TextBox(int posX, int posY, const char *titleName, bool passwordStatus)
         : RectangularShape(posX, posY, 200, 30),
         Clickable(STEEL_BLUE, PALE_AZURE),
-        fill(SEASALT), textColor(TIFFANY_BLUE), length(0), isPassword(passwordStatus)
+        length(0), fill(SEASALT), textColor(TIFFANY_BLUE), isPassword(passwordStatus)
     {
         strcpy(title, titleName);
         text[0] = '\0';
@@ -567,11 +176,9 @@ public:
         }
     }
 
-    char *getText()
+    TextView getText()
     {
-        char *textCopy = (char *)malloc(100 * sizeof(char));
-        strcpy(textCopy, text);
-        return textCopy;
+        return TextView{text, length};
     }
 
     int getLength()
@@ -581,20 +188,16 @@ public:
 
     void draw()
     {
-        DrawText(title, positionX - MeasureText(title, 20) / 2, positionY - 25, 20, textColor);
+        textRenderer.drawCentered(title, positionX, positionY - 25, 20, textColor);
         DrawRectangleRec(Rectangle{(float)positionX - width / 2, (float)positionY, (float)width, (float)height}, fill);
         DrawRectangleLines(positionX - width / 2, positionY, width, height, isFocus ? focus : normal);
         if (isPassword)
         {
-            char hiddenPassword[100] = "";
-            for (int i = 0; i < length; i++)
-                hiddenPassword[i] = '*';
-            hiddenPassword[length] = '\0';
-            DrawText(hiddenPassword, positionX - MeasureText(hiddenPassword, 20) / 2, positionY + 5, 20, textColor);
+            textRenderer.drawCentered(frameArena.repeat('*', length), positionX, positionY + 5, 20, textColor);
         }
         else
         {
-            DrawText(text, positionX - MeasureText(text, 20) / 2, positionY + 5, 20, textColor);
+            textRenderer.drawCentered(getText(), positionX, positionY + 5, 20, textColor);
         }
     }
 
@@ -621,133 +224,55 @@ public:
     {
         DrawRectangleRec(Rectangle{(float)positionX - width / 2, (float)positionY, (float)width, (float)height}, fill);
         DrawRectangleLines(positionX - width / 2, positionY, width, height, isFocus ? focus : normal);
-        DrawText(title, positionX - MeasureText(title, 20) / 2, positionY + 5, 20, textColor);
+        textRenderer.drawCentered(title, positionX, positionY + 5, 20, textColor);
     }
 };
-//CLASS TEXT
-class Text : public Shape
-{
-private:
-    char text[100];
-    Color color;
-
-public:
-    Text(const char *txt, Color col, int posX, int posY) : Shape(posX, posY), color(col)
-    {
-        strncpy(text, txt, sizeof(text) - 1);
-        text[sizeof(text) - 1] = '\0';
-    }
-
-    void draw()
-    {
-        DrawText(text, positionX - MeasureText(text, 20) / 2, positionY, 20, color);
-    }
-
-    void updateText(char *txt)
-    {
-        strncpy(text, txt, sizeof(text) - 1);
-        text[sizeof(text) - 1] = '\0';
-    }
-};
-
-//CLASS CHECKBOX
-class CheckBox : public RectangularShape, public Clickable
-{
-private:
-    char title[20];
-    Color unChecked;
-    Color checked;
-    Color textColor;
-    bool isChecked;
-
-public:
-    CheckBox(int posX, int posY, const char *titleName)
-        : RectangularShape(posX, posY, 30, 30),
-        Clickable(STEEL_BLUE, PALE_AZURE),
-        unChecked(ASH_GRAY),
-        checked(PANTONE),
-        textColor(TIFFANY_BLUE),
-        isChecked(false)
-    {
-        strcpy(title, titleName);
-    }
-
-    void draw()
-    {
-        DrawRectangleRec(Rectangle{(float)positionX - width / 2, (float)positionY, (float)width, (float)height}, isChecked ? checked : unChecked);
-        DrawRectangleLines(positionX - width / 2, positionY, width, height, isFocus ? focus : normal);
-        DrawText(title, positionX + width + 5, positionY + 5, 20, textColor);
-    }
-
-    void toggleCheck()
-    {
-        isChecked = !isChecked;
-    }
-
-    void setCheck(bool status)
-    {
-        isChecked = status;
-    }
-
-    bool getCheck()
-    {
-        return isChecked;
-    }
-};
-
 bool checkLogin(TextBox *username, TextBox *password, Button *login);
-bool checkMainMenuSelections(CheckBox *singlePlayer, CheckBox *multiPlayer,
-                             CheckBox *regular, CheckBox *sin, CheckBox *curve,
-                             CheckBox *easy, CheckBox *medium, CheckBox *hard,
-                             CheckBox *cpp, CheckBox *assembly);
-bool loginMenu(Player *player, double *calculationTime);
-bool mainMenu(GameMode *gameMode);
-bool game(Player *player1, Player *player2, GameMode *gameMode, double *calculationTime);
-float regularPath(int velocity, GameMode *gameMode);
-float sinPath(int velocity, int time, GameMode *gameMode);
-float curvePath(int positionX, int positionY, GameMode *gameMode);
-void drawLine(GameMode *gameMode, double *calculationTime);
+bool loginMenu(Player *player, Profiler *profiler);
+bool mainMenu(GameMode *gameMode, FrameScheduler *scheduler);
+bool game(Player *player1, Player *player2, GameMode *gameMode, GameOptions *options, FrameScheduler *scheduler,
+          Profiler *profiler, Telemetry *telemetry);
+bool hostGame(Player *player1, Player *player2, GameMode *gameMode, GameOptions *options, FrameScheduler *scheduler,
+              Profiler *profiler, Telemetry *telemetry);
+bool joinGame(const char *address, Player *player1, Player *player2, GameOptions *options, FrameScheduler *scheduler,
+              Profiler *profiler, Telemetry *telemetry);
+void drawLine(GameMode *gameMode, Profiler *profiler);
 //FUNCTIONS TO USE AND SET SETTINGS
-bool checkMainMenuSelections(CheckBox *singlePlayer, CheckBox *multiPlayer,
-                             CheckBox *regular, CheckBox *sin, CheckBox *curve,
-                             CheckBox *easy, CheckBox *medium, CheckBox *hard,
-                             CheckBox *cpp, CheckBox *assembly)
+enum MainMenuGroup
 {
-    bool hasGameMode = singlePlayer->getCheck() || multiPlayer->getCheck();
-    bool hasPath = regular->getCheck() || sin->getCheck() || curve->getCheck();
-    bool hasDifficulty = easy->getCheck() || medium->getCheck() || hard->getCheck();
-    bool hasLanguage = cpp->getCheck() || assembly->getCheck();
-    return hasGameMode && hasPath && hasDifficulty && hasLanguage;
-}
+    PlayersGroup,
+    PathGroup,
+    DifficultyGroup,
+    ProgramGroup
+};
 
-bool mainMenu(GameMode *gameMode)
+#define START_GAME 1
+
+static const WidgetSpec mainMenuTable[] = {
+    {WidgetKind::Heading, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 375, "MAIN MENU", -1, 0},
+    {WidgetKind::Label, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 325, "Choose the game mode:", -1, 0},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 - 200, SCREEN_HEIGHT / 2 - 250, "SINGLEPLAYER", PlayersGroup, 1},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 + 200, SCREEN_HEIGHT / 2 - 250, "MULTIPLAYER", PlayersGroup, 2},
+    {WidgetKind::Label, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 175, "Choose the ball's path:", -1, 0},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 - 300, SCREEN_HEIGHT / 2 - 100, "REGULAR", PathGroup, (int)Path::Regular},
+    {WidgetKind::Option, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 100, "SIN", PathGroup, (int)Path::Sin},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 + 300, SCREEN_HEIGHT / 2 - 100, "CURVE", PathGroup, (int)Path::Curve},
+    {WidgetKind::Label, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 25, "Choose game's difficulty:", -1, 0},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 - 300, SCREEN_HEIGHT / 2 + 50, "EASY", DifficultyGroup, (int)Difficulty::Easy},
+    {WidgetKind::Option, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 50, "MEDIUM", DifficultyGroup, (int)Difficulty::Meduim},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 + 300, SCREEN_HEIGHT / 2 + 50, "HARD", DifficultyGroup, (int)Difficulty::Hard},
+    {WidgetKind::Label, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 125, "Choose the language used in hot patrs:", -1, 0},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 - 200, SCREEN_HEIGHT / 2 + 200, "C++", ProgramGroup, (int)Program::Cpp},
+    {WidgetKind::Option, SCREEN_WIDTH / 2 + 200, SCREEN_HEIGHT / 2 + 200, "ASSEMBLY", ProgramGroup, (int)Program::Assembly},
+    {WidgetKind::Button, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 275, "Start", -1, START_GAME}};
+
+// Input becomes MenuEvents; the menu only repaints what they changed, and
+// in between waits for the next input without drawing.
+bool mainMenu(GameMode *gameMode, FrameScheduler *scheduler)
 {
-    Text title("MAIN MENU", PANTONE, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 375);
-    Text guide("Choose the game mode:", LAPIS_LAZULI, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 325);
-    Text ballPath("Choose the ball's path:", LAPIS_LAZULI, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 175);
-    Text difficulty("Choose game's difficulty:", LAPIS_LAZULI, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 25);
-    Text hotPart("Choose the language used in hot patrs:", LAPIS_LAZULI, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 125);
-
-    CheckBox singlePlayer(SCREEN_WIDTH / 2 - 200, SCREEN_HEIGHT / 2 - 250, "SINGLEPLAYER");
-    CheckBox multiPlayer(SCREEN_WIDTH / 2 + 200, SCREEN_HEIGHT / 2 - 250, "MULTIPLAYER");
-    singlePlayer.setCheck(true);
-    singlePlayer.setFocus(true);
-
-    CheckBox regular(SCREEN_WIDTH / 2 - 300, SCREEN_HEIGHT / 2 - 100, "REGULAR");
-    CheckBox sin(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 100, "SIN");
-    CheckBox curve(SCREEN_WIDTH / 2 + 300, SCREEN_HEIGHT / 2 - 100, "CURVE");
-    regular.setCheck(true);
-
-    CheckBox easy(SCREEN_WIDTH / 2 - 300, SCREEN_HEIGHT / 2 + 50, "EASY");
-    CheckBox medium(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 50, "MEDIUM");
-    CheckBox hard(SCREEN_WIDTH / 2 + 300, SCREEN_HEIGHT / 2 + 50, "HARD");
-    easy.setCheck(true);
-
-    CheckBox cpp(SCREEN_WIDTH / 2 - 200, SCREEN_HEIGHT / 2 + 200, "C++");
-    CheckBox assembly(SCREEN_WIDTH / 2 + 200, SCREEN_HEIGHT / 2 + 200, "ASSEMBLY");
-    cpp.setCheck(true);
-
-    Button startGame(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 275, "Start");
+    MenuStyle style = {CAROLINA_BLUE, PANTONE, LAPIS_LAZULI, TIFFANY_BLUE, STEEL_BLUE,
+                       PALE_AZURE, ASH_GRAY, PANTONE, HUNYADI_YELLOW};
+    Menu menu(mainMenuTable, sizeof(mainMenuTable) / sizeof(mainMenuTable[0]), &style);
 
     bool start = false;
 
@@ -755,488 +280,474 @@ bool mainMenu(GameMode *gameMode)
     {
         if (IsKeyPressed(KEY_TAB))
         {
-            if (singlePlayer.getFocus())
-            {
-                singlePlayer.setFocus(false);
-                multiPlayer.setFocus(true);
-            }
-            else if (multiPlayer.getFocus())
-            {
-                multiPlayer.setFocus(false);
-                regular.setFocus(true);
-            }
-            else if (regular.getFocus())
-            {
-                regular.setFocus(false);
-                sin.setFocus(true);
-            }
-            else if (sin.getFocus())
-            {
-                sin.setFocus(false);
-                curve.setFocus(true);
-            }
-            else if (curve.getFocus())
-            {
-                curve.setFocus(false);
-                easy.setFocus(true);
-            }
-            else if (easy.getFocus())
-            {
-                easy.setFocus(false);
-                medium.setFocus(true);
-            }
-            else if (medium.getFocus())
-            {
-                medium.setFocus(false);
-                hard.setFocus(true);
-            }
-            else if (hard.getFocus())
-            {
-                hard.setFocus(false);
-                cpp.setFocus(true);
-            }
-            else if (cpp.getFocus())
-            {
-                cpp.setFocus(false);
-                assembly.setFocus(true);
-            }
-            else if (assembly.getFocus())
-            {
-                assembly.setFocus(false);
-                startGame.setFocus(true);
-            }
-            else if (startGame.getFocus())
-            {
-                startGame.setFocus(false);
-                singlePlayer.setFocus(true);
-            }
+            MenuEvent event = {MenuEventType::Next, 0, 0};
+            menu.dispatch(&event);
         }
         if (IsKeyPressed(KEY_ENTER))
         {
-            if (singlePlayer.getFocus())
-            {
-                singlePlayer.toggleCheck();
-                if (singlePlayer.getCheck())
-                {
-                    multiPlayer.setCheck(false);
-                }
-            }
-            else if (multiPlayer.getFocus())
-            {
-                multiPlayer.toggleCheck();
-                if (multiPlayer.getCheck())
-                {
-                    singlePlayer.setCheck(false);
-                }
-            }
-            else if (regular.getFocus())
-            {
-                regular.toggleCheck();
-                if (regular.getCheck())
-                {
-                    sin.setCheck(false);
-                    curve.setCheck(false);
-                }
-            }
-            else if (sin.getFocus())
-            {
-                sin.toggleCheck();
-                if (sin.getCheck())
-                {
-                    regular.setCheck(false);
-                    curve.setCheck(false);
-                }
-            }
-            else if (curve.getFocus())
-            {
-                curve.toggleCheck();
-                if (curve.getCheck())
-                {
-                    regular.setCheck(false);
-                    sin.setCheck(false);
-                }
-            }
-            else if (easy.getFocus())
-            {
-                easy.toggleCheck();
-                if (easy.getCheck())
-                {
-                    medium.setCheck(false);
-                    hard.setCheck(false);
-                }
-            }
-            else if (medium.getFocus())
-            {
-                medium.toggleCheck();
-                if (medium.getCheck())
-                {
-                    easy.setCheck(false);
-                    hard.setCheck(false);
-                }
-            }
-            else if (hard.getFocus())
-            {
-                hard.toggleCheck();
-                if (hard.getCheck())
-                {
-                    easy.setCheck(false);
-                    medium.setCheck(false);
-                }
-            }
-            else if (cpp.getFocus())
-            {
-                cpp.toggleCheck();
-                if (cpp.getCheck())
-                {
-                    assembly.setCheck(false);
-                }
-            }
-            else if (assembly.getFocus())
-            {
-                assembly.toggleCheck();
-                if (assembly.getCheck())
-                {
-                    cpp.setCheck(false);
-                }
-            }
-            else if (startGame.getFocus())
-            {
-                start = checkMainMenuSelections(&singlePlayer, &multiPlayer,
-                                                &regular, &sin, &curve,
-                                                &easy, &medium, &hard,
-                                                &cpp, &assembly);
-            }
+            MenuEvent event = {MenuEventType::Activate, 0, 0};
+            start = menu.dispatch(&event) == START_GAME;
+        }
+        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        {
+            Vector2 mousePoint = GetMousePosition();
+            MenuEvent event = {MenuEventType::Click, mousePoint.x, mousePoint.y};
+            start = menu.dispatch(&event) == START_GAME || start;
         }
 
-        Vector2 mousePoint = GetMousePosition();
-        if (startGame.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        if (menu.needsUpdate() || IsWindowResized())
         {
-            start = checkMainMenuSelections(&singlePlayer, &multiPlayer,
-                                            &regular, &sin, &curve,
-                                            &easy, &medium, &hard,
-                                            &cpp, &assembly);
+            scheduler->requestRedraw();
         }
-        else if (singlePlayer.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        if (!scheduler->shouldDraw())
         {
-            singlePlayer.setFocus(true);
-            singlePlayer.setCheck(true);
-            multiPlayer.setFocus(false);
-            multiPlayer.setCheck(false);
-            regular.setFocus(false);
-            sin.setFocus(false);
-            curve.setFocus(false);
-            easy.setFocus(false);
-            medium.setFocus(false);
-            hard.setFocus(false);
+            scheduler->idle();
+            continue;
         }
-        else if (multiPlayer.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+
+        menu.update();
+        beginDrawing();
+        menu.draw();
+        scheduler->endDrawing();
+    }
+
+    gameMode->numberOfPlayer = menu.getValue(PlayersGroup, 1);
+    gameMode->path = (Path)menu.getValue(PathGroup, (int)Path::Regular);
+    gameMode->difficulty = (Difficulty)menu.getValue(DifficultyGroup, (int)Difficulty::Easy);
+    gameMode->program = (Program)menu.getValue(ProgramGroup, (int)Program::Cpp);
+
+    return gameMode->numberOfPlayer == 1;
+}
+
+// P pauses: the simulation thread blocks, and the last frame stays up with
+// a blinking PAUSED that is the only thing drawn until P is pressed again.
+bool game(Player *player1, Player *player2, GameMode *gameMode, GameOptions *options, FrameScheduler *scheduler,
+          Profiler *profiler, Telemetry *telemetry)
+{
+    Random random(options->seed);
+    Platform platform = {seededRandomValue, raylibKeyDown, &random};
+    // The simulation thread has a profiler of its own; the pipeline charges its zones to profiler
+    Profiler simulationProfiler;
+    Simulation simulation(gameMode, player1, player2, options->tickRate, options->chaosBalls, &platform, &simulationProfiler);
+    Keys keys = {KEY_W, KEY_S, KEY_UP, KEY_DOWN};
+    ReplayWriter replay;
+    if (options->record && !replay.open(options->record, options->seed, gameMode, options->tickRate, options->chaosBalls))
+    {
+        TraceLog(LOG_WARNING, "Cannot record the replay to %s", options->record);
+    }
+    BallRenderer ballRenderer(simulation.getBall()->getRadius(), STEEL_BLUE, TIFFANY_BLUE, SEASALT);
+    RenderCache court;
+    Color courtColors[2] = {CAROLINA_BLUE, PANTONE};
+
+    // Physics runs at the tick rate on its own thread however fast frames come
+    Pipeline pipeline(&simulation, player1, player2, options->record ? &replay : NULL, &simulationProfiler);
+    pipeline.start();
+    long lastTick = 0;
+    uint64_t lastInput = 0;
+    long frame = 0;
+    uint64_t lastAllocations = heapAllocations.load(std::memory_order_relaxed);
+
+    // Names and scores are only formatted again when they change
+    TextRun leftName;
+    TextRun rightName;
+    TextRun leftScore;
+    TextRun rightScore;
+    leftName.setText(player1->getName());
+    rightName.setText(player2->getName());
+
+    bool paused = false;
+    bool showPaused = false;
+    double blinkAt = 0;
+
+    while (!WindowShouldClose())
+    {
+        if (IsKeyPressed(KEY_P))
         {
-            singlePlayer.setFocus(false);
-            singlePlayer.setCheck(false);
-            multiPlayer.setFocus(true);
-            multiPlayer.setCheck(true);
-            regular.setFocus(false);
-            sin.setFocus(false);
-            curve.setFocus(false);
-            easy.setFocus(false);
-            medium.setFocus(false);
-            hard.setFocus(false);
+            paused = !paused;
+            pipeline.setPaused(paused);
+            profiler->restartFrameClock();
+            showPaused = paused;
+            blinkAt = GetTime() + PAUSE_BLINK;
+            scheduler->requestRedraw();
         }
-        else if (regular.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+
+        if (!paused)
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(true);
-            regular.setCheck(true);
-            sin.setFocus(false);
-            sin.setCheck(false);
-            curve.setFocus(false);
-            curve.setCheck(false);
-            easy.setFocus(false);
-            medium.setFocus(false);
-            hard.setFocus(false);
+            pipeline.submit(sampleInput(&platform, keys));
+            scheduler->requestRedraw();
         }
-        else if (sin.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        else if (GetTime() >= blinkAt)
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(false);
-            regular.setCheck(false);
-            sin.setFocus(true);
-            sin.setCheck(true);
-            curve.setFocus(false);
-            curve.setCheck(false);
-            easy.setFocus(false);
-            medium.setFocus(false);
-            hard.setFocus(false);
+            showPaused = !showPaused;
+            blinkAt = GetTime() + PAUSE_BLINK;
+            scheduler->requestRedraw();
         }
-        else if (curve.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        if (IsWindowResized())
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(false);
-            regular.setCheck(false);
-            sin.setFocus(false);
-            sin.setCheck(false);
-            curve.setFocus(true);
-            curve.setCheck(true);
-            easy.setFocus(false);
-            medium.setFocus(false);
-            hard.setFocus(false);
+            scheduler->requestRedraw();
         }
-        else if (easy.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        if (!scheduler->shouldDraw())
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(false);
-            sin.setFocus(false);
-            curve.setFocus(false);
-            easy.setFocus(true);
-            easy.setCheck(true);
-            medium.setFocus(false);
-            medium.setCheck(false);
-            hard.setFocus(false);
-            hard.setCheck(false);
+            scheduler->wakeAt(blinkAt);
+            scheduler->idle();
+            continue;
         }
-        else if (medium.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+
+        const Snapshot *snapshot = pipeline.acquire(profiler);
+        float alpha = pipeline.alpha(snapshot);
+
+        // The court never changes, so it is only drawn again for a new palette or screen size
+        if (court.begin(GetScreenWidth(), GetScreenHeight(), paletteKey(courtColors, 2)))
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(false);
-            sin.setFocus(false);
-            curve.setFocus(false);
-            easy.setFocus(false);
-            easy.setCheck(false);
-            medium.setFocus(true);
-            medium.setCheck(true);
-            hard.setFocus(false);
-            hard.setCheck(false);
+            ClearBackground(CAROLINA_BLUE);
+            drawLine(gameMode, profiler);
+            court.end();
         }
-        else if (hard.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+
+        beginDrawing();
+        court.draw();
+
+        ballRenderer.begin(gameMode, profiler);
+        drawBalls(snapshot, alpha, &ballRenderer);
+        drawBall(&snapshot->ball, snapshot->spin, alpha, &ballRenderer);
+        ballRenderer.end();
+        drawPaddle(&snapshot->leftPaddle, alpha);
+        drawPaddle(&snapshot->rightPaddle, alpha);
+        leftScore.setNumber(snapshot->leftScore);
+        rightScore.setNumber(snapshot->rightScore);
+        textRenderer.draw(leftName.view(), 10, 10, 20, LAPIS_LAZULI);
+        textRenderer.draw(rightName.view(), SCREEN_WIDTH - 100, 10, 20, LAPIS_LAZULI);
+        textRenderer.draw(leftScore.view(), 10, 40, 20, LAPIS_LAZULI);
+        textRenderer.draw(rightScore.view(), SCREEN_WIDTH - 100, 40, 20, LAPIS_LAZULI);
+        if (showPaused)
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(false);
-            sin.setFocus(false);
-            curve.setFocus(false);
-            easy.setFocus(false);
-            easy.setCheck(false);
-            medium.setFocus(false);
-            medium.setCheck(false);
-            hard.setFocus(true);
-            hard.setCheck(true);
+            textRenderer.draw("PAUSED", (SCREEN_WIDTH - textRenderer.measure("PAUSED", 40)) / 2, SCREEN_HEIGHT / 2 - 20, 40,
+                              LAPIS_LAZULI);
         }
-        else if (cpp.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        textRenderer.flush();
+        scheduler->endDrawing();
+
+        if (paused)
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(false);
-            sin.setFocus(false);
-            curve.setFocus(false);
-            easy.setFocus(false);
-            medium.setFocus(false);
-            hard.setFocus(false);
-            cpp.setFocus(true);
-            cpp.setCheck(true);
-            assembly.setFocus(false);
-            assembly.setCheck(false);
+            continue;
         }
-        else if (assembly.checkCollision(mousePoint) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+
+        // Latency is counted on the first frame that shows a tick using a new input
+        Latency latency = {0, 0};
+        if (snapshot->inputTime != lastInput)
         {
-            singlePlayer.setFocus(false);
-            multiPlayer.setFocus(false);
-            regular.setFocus(false);
-            sin.setFocus(false);
-            curve.setFocus(false);
-            easy.setFocus(false);
-            medium.setFocus(false);
-            hard.setFocus(false);
-            cpp.setFocus(false);
-            cpp.setCheck(false);
-            assembly.setFocus(true);
-            assembly.setCheck(true);
+            latency.tick = snapshot->tickTime - snapshot->inputTime;
+            latency.present = nanoseconds() - snapshot->inputTime;
+            lastInput = snapshot->inputTime;
         }
 
-        BeginDrawing();
-        ClearBackground(CAROLINA_BLUE);
+        profiler->endFrame();
+        telemetry->frame(profiler, (int)(snapshot->tick - lastTick), 1 + snapshot->balls, &latency);
+        lastTick = snapshot->tick;
 
-        title.draw();
-        guide.draw();
-        ballPath.draw();
-        difficulty.draw();
-        hotPart.draw();
-        singlePlayer.draw();
-        multiPlayer.draw();
-        regular.draw();
-        sin.draw();
-        curve.draw();
-        easy.draw();
-        medium.draw();
-        hard.draw();
-        cpp.draw();
-        assembly.draw();
-        startGame.draw();
-
-        EndDrawing();
+        // Past the first second, which warms up every buffer, frames must not touch the heap
+        uint64_t allocations = heapAllocations.load(std::memory_order_relaxed);
+        frame++;
+        if (allocations != lastAllocations && frame > FPS)
+        {
+            TraceLog(LOG_WARNING, "Frame %ld made %llu heap allocations", frame,
+                     (unsigned long long)(allocations - lastAllocations));
+        }
+        lastAllocations = allocations;
     }
 
-    if (multiPlayer.getCheck())
+    pipeline.stop();
+    ScheduleReport schedule = scheduler->report();
+    telemetry->schedule("game", &schedule);
+    if (options->record)
     {
-        gameMode->numberOfPlayer = 2;
+        replay.close(simulationChecksum(&simulation, player1, player2));
     }
 
-    if (sin.getCheck())
+    return true;
+}
+
+// Runs the server for an online match on its own thread, with options->host
+// as its port, and joins it over loopback like the other player does.
+bool hostGame(Player *player1, Player *player2, GameMode *gameMode, GameOptions *options, FrameScheduler *scheduler,
+              Profiler *profiler, Telemetry *telemetry)
+{
+    Random random(options->seed);
+    Platform platform = {seededRandomValue, raylibKeyDown, &random};
+    Simulation simulation(gameMode, player1, player2, options->tickRate, 0, &platform, NULL);
+    ReplayWriter replay;
+    if (options->record && !replay.open(options->record, options->seed, gameMode, options->tickRate, 0))
     {
-        gameMode->path = Path::Sin;
+        TraceLog(LOG_WARNING, "Cannot record the replay to %s", options->record);
     }
-    else if (curve.getCheck())
+    NetServer server(&simulation, player1, player2, gameMode, options->tickRate, options->record ? &replay : NULL,
+                     telemetry);
+    if (!server.open(options->host, options->tuning.conditions, options->seed))
     {
-        gameMode->path = Path::Curve;
+        TraceLog(LOG_WARNING, "Cannot host on port %d", options->host);
+        return false;
     }
+    server.start();
 
-    if (medium.getCheck())
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%d", options->host);
+    bool played = joinGame(address, player1, player2, options, scheduler, profiler, telemetry);
+
+    server.stop();
+    if (options->record)
     {
-        gameMode->difficulty = Difficulty::Meduim;
+        replay.close(simulationChecksum(&simulation, player1, player2));
     }
-    else
+    return played;
+}
+
+// Until the server has both players the window only says so. Once the
+// match is on, every frame sends this keyboard's buttons and draws what the
+// client predicts; there is no pausing a match someone else is playing.
+bool joinGame(const char *address, Player *player1, Player *player2, GameOptions *options, FrameScheduler *scheduler,
+              Profiler *profiler, Telemetry *telemetry)
+{
+    Platform platform = {seededRandomValue, raylibKeyDown, NULL};
+    Keys keys = {KEY_W, KEY_S, KEY_UP, KEY_DOWN};
+    NetClient client(options->tuning, telemetry);
+    if (!client.open(address, options->seed))
     {
-        gameMode->difficulty = Difficulty::Hard;
+        TraceLog(LOG_WARNING, "Cannot reach %s", address);
+        return false;
     }
 
-    if (assembly.getCheck())
+    const char *status = NULL;
+    while (!WindowShouldClose() && !client.isPlaying() && !client.hasEnded())
     {
-        gameMode->program = Program::Assembly;
+        client.update(0);
+        const char *text = client.isWelcomed() ? "WAITING FOR PLAYER" : "CONNECTING";
+        if (text != status || IsWindowResized())
+        {
+            status = text;
+            scheduler->requestRedraw();
+        }
+        if (!scheduler->shouldDraw())
+        {
+            scheduler->wakeAt(GetTime() + 1.0 / FPS);
+            scheduler->idle();
+            continue;
+        }
+        beginDrawing();
+        ClearBackground(CAROLINA_BLUE);
+        textRenderer.drawCentered(status, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 20, 40, LAPIS_LAZULI);
+        textRenderer.flush();
+        scheduler->endDrawing();
+    }
+    if (!client.isPlaying())
+    {
+        return false;
     }
 
-    return singlePlayer.getCheck();
-}
+    // A player who did not host only learns the game mode from the server
+    GameMode gameMode = client.getGameMode();
+    if (!options->host)
+    {
+        Session session = {options->seed, gameMode, client.getTickRate(), 0};
+        if (!telemetry->open(options->telemetry, &session))
+        {
+            TraceLog(LOG_WARNING, "Cannot write telemetry to %s", options->telemetry);
+        }
+    }
 
-bool game(Player *player1, Player *player2, GameMode *gameMode, double *calculationTime)
-{
-    Ball ball(*gameMode, calculationTime);
-    LeftPaddle leftPaddle(0, SCREEN_HEIGHT / 2);
-    RightPaddle rightPaddle(SCREEN_WIDTH, SCREEN_HEIGHT / 2, gameMode->numberOfPlayer == 1);
+    // The server's ball always has a radius of 10
+    BallRenderer ballRenderer(10, STEEL_BLUE, TIFFANY_BLUE, SEASALT);
+    RenderCache court;
+    Color courtColors[2] = {CAROLINA_BLUE, PANTONE};
+    Snapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    long lastTick = 0;
 
-    while (!WindowShouldClose())
+    TextRun leftName;
+    TextRun rightName;
+    TextRun leftScore;
+    TextRun rightScore;
+    leftName.setText(player1->getName());
+    rightName.setText(player2->getName());
+    profiler->restartFrameClock();
+
+    while (!WindowShouldClose() && !client.hasEnded())
     {
-        ball.update(player1, player2);
-        leftPaddle.update();
-        rightPaddle.update(ball);
-        ball.collision(leftPaddle);
-        ball.collision(rightPaddle);
+        client.update(sampleInput(&platform, keys));
+        client.fill(&snapshot);
 
-        BeginDrawing();
-        ClearBackground(CAROLINA_BLUE);
+        if (court.begin(GetScreenWidth(), GetScreenHeight(), paletteKey(courtColors, 2)))
+        {
+            ClearBackground(CAROLINA_BLUE);
+            drawLine(&gameMode, profiler);
+            court.end();
+        }
 
-        drawLine(gameMode, calculationTime);
+        beginDrawing();
+        court.draw();
 
-        ball.draw();
-        leftPaddle.draw();
-        rightPaddle.draw();
-        DrawText(player1->getName(), 10, 10, 20, LAPIS_LAZULI);
-        DrawText(player2->getName(), SCREEN_WIDTH - 100, 10, 20, LAPIS_LAZULI);
-        DrawText(TextFormat("%i", player1->getScore()), 10, 40, 20, LAPIS_LAZULI);
-        DrawText(TextFormat("%i", player2->getScore()), SCREEN_WIDTH - 100, 40, 20, LAPIS_LAZULI);
-        EndDrawing();
+        ballRenderer.begin(&gameMode, profiler);
+        drawBall(&snapshot.ball, snapshot.spin, snapshot.alpha, &ballRenderer);
+        ballRenderer.end();
+        drawPaddle(&snapshot.leftPaddle, snapshot.alpha);
+        drawPaddle(&snapshot.rightPaddle, snapshot.alpha);
+        leftScore.setNumber(snapshot.leftScore);
+        rightScore.setNumber(snapshot.rightScore);
+        textRenderer.draw(leftName.view(), 10, 10, 20, LAPIS_LAZULI);
+        textRenderer.draw(rightName.view(), SCREEN_WIDTH - 100, 10, 20, LAPIS_LAZULI);
+        textRenderer.draw(leftScore.view(), 10, 40, 20, LAPIS_LAZULI);
+        textRenderer.draw(rightScore.view(), SCREEN_WIDTH - 100, 40, 20, LAPIS_LAZULI);
+        textRenderer.flush();
+        scheduler->endDrawing();
+
+        // Input to screen latency is in the net records, as the round trip
+        Latency latency = {0, 0};
+        profiler->endFrame();
+        telemetry->frame(profiler, (int)(snapshot.tick - lastTick), 1, &latency);
+        lastTick = snapshot.tick;
     }
 
+    client.close();
+    ScheduleReport schedule = scheduler->report();
+    telemetry->schedule("game", &schedule);
     return true;
 }
 
-float regularPath(int velocity, GameMode *gameMode)
+// Filled circle whose color brightens by scale per pixel towards the
+// center, drawn as rings delta apart from the outside in.
+void drawRadialGradient(int centerX, int centerY, float radius, float delta, Color color, float scale,
+                        GameMode *gameMode, Profiler *profiler)
 {
-    if (gameMode->program == Program::Cpp)
-    {
-        return velocity / (float)FPS;
-    }
-    else
-    {
-        return R(velocity);
-    }
-}
+    const int chunk = 256;
+    float rings[chunk];
+    unsigned packed[chunk];
+    Color gradientColors[chunk];
+    unsigned base;
+    memcpy(&base, &color, sizeof(base));
 
-float sinPath(int velocity, int time, GameMode *gameMode)
-{
-    if (gameMode->program == Program::Cpp)
+    float i = radius;
+    while (i > 0)
     {
-        const float frequency = 0.05f;
-        float baseMovement = velocity / FPS;
-        float sineComponent = sin(frequency * time);
-        return baseMovement * sineComponent;
-    }
-    else
-    {
-        return S(velocity, time);
-    }
-}
+        int count = 0;
 
-float curvePath(int positionX, int positionY, GameMode *gameMode)
-{
-    if (gameMode->program == Program::Cpp)
-    {
-        const float constant = 1000;
-        positionX -= SCREEN_WIDTH / 2;
-        positionY -= SCREEN_HEIGHT / 2;
-        float norm = positionX * positionX + positionY * positionY;
-        if (norm < 25)
+        // Only the gradient math is timed, the raylib calls below are not
         {
-            return 0;
+            ScopedTimer timer(profiler, GradientZone);
+
+            for (; i > 0 && count < chunk; i -= delta)
+            {
+                rings[count++] = i;
+            }
+            gradientBatch(base, rings, packed, count, radius, scale, gameMode);
+            memcpy(gradientColors, packed, count * sizeof(Color));
         }
-        else
+
+        for (int k = 0; k < count; k++)
         {
-            return constant * positionY / norm;
+            DrawCircle(centerX, centerY, rings[k], gradientColors[k]);
         }
     }
-    else
-    {
-        return C(positionX, positionY);
-    }
 }
 
-void drawLine(GameMode *gameMode, double *calculationTime)
+void drawLine(GameMode *gameMode, Profiler *profiler)
 {
     DrawLine(SCREEN_WIDTH / 2, 0, SCREEN_WIDTH / 2, SCREEN_HEIGHT, PANTONE);
-    Color color = CAROLINA_BLUE;
     int radius = 128;
-    float delta = 0.1f;
-    
-    double temporaryTime = time(NULL);
-
-    for (float i = radius; i > 0; i -= delta)
-    {
-        Color gradientColor;
-        if (gameMode->program == Program::Cpp)
-        {
-            gradientColor = {
-                (unsigned char)fmin(color.r + (radius - i) * 0.5, 255),
-                (unsigned char)fmin(color.g + (radius - i) * 0.5, 255),
-                (unsigned char)fmin(color.b + (radius - i) * 0.5, 255),
-                color.a};
-        }
-        else
-        {
-            gradientColor = {
-                (unsigned char)G(color.r, i),
-                (unsigned char)G(color.g, i),
-                (unsigned char)G(color.b, i),
-                color.a};
-        }
-
-        DrawCircle(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, i, gradientColor);
-    }
 
-    *calculationTime += time(NULL) - temporaryTime;
+    drawRadialGradient(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, radius, 0.1f, CAROLINA_BLUE, 0.5f, gameMode, profiler);
 
     DrawCircleLines(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, radius, PANTONE);
 }
 
 
-double executionTime = 0;
-double calculationTime = 0;
-
-int main()
+Profiler profiler;
+Telemetry telemetry;
+
+// ./game.out [--chaos N] [--tick-rate N] [--seed N] [--record FILE] [--telemetry FILE] [--isa NAME]
+//            [--host PORT | --connect HOST[:PORT]] [--latency MS] [--jitter MS] [--loss PERCENT]
+//            [--input-delay N] [--rollback N]
+// --chaos adds N extra balls (chaos mode); for 10k+ balls a --tick-rate of
+// FPS keeps the physics inside the frame budget. --record saves the match
+// as a replay for headless.out --replay. Session and frame records are
+// appended to --telemetry (telemetry.jsonl); the session id is the seed.
+// --isa (or PONG_ISA) picks the ASM kernel variants: scalar, sse, avx2, fma
+// or avx512, if the CPU has them.
+// --host starts an online match for two (see netplay.h) after the menu and
+// --connect joins one, without a menu, on port NET_PORT unless given; the
+// match runs at NET_TICK_RATE unless --tick-rate says otherwise, without
+// chaos balls, and --record works on the host only. --latency, --jitter and
+// --loss simulate a network on everything this process sends, and
+// --input-delay and --rollback tune prediction (NET_DELAY, NET_ROLLBACK).
+int main(int argc, char **argv)
 {
-    double temporaryTime = time(NULL);
+    uint64_t startTime = nanoseconds();
+    GameOptions options = {
+        .tickRate = TICK_RATE,
+        .chaosBalls = 0,
+        .seed = startTime,
+        .record = NULL,
+        .telemetry = "telemetry.jsonl",
+        .host = 0,
+        .connect = NULL,
+        .tuning = {NET_DELAY, NET_ROLLBACK, {0, 0, 0}}};
+    bool tickRateSet = false;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (!strcmp(argv[i], "--chaos"))
+        {
+            options.chaosBalls = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--tick-rate"))
+        {
+            options.tickRate = atoi(argv[++i]);
+            options.tickRate = options.tickRate > 0 ? options.tickRate : TICK_RATE;
+            tickRateSet = true;
+        }
+        else if (!strcmp(argv[i], "--seed"))
+        {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "--record"))
+        {
+            options.record = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--telemetry"))
+        {
+            options.telemetry = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--host"))
+        {
+            options.host = atoi(argv[++i]);
+            options.host = options.host > 0 && options.host <= 65535 ? options.host : NET_PORT;
+        }
+        else if (!strcmp(argv[i], "--connect"))
+        {
+            options.connect = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--latency"))
+        {
+            options.tuning.conditions.latency = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--jitter"))
+        {
+            options.tuning.conditions.jitter = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--loss"))
+        {
+            options.tuning.conditions.loss = atof(argv[++i]) / 100;
+        }
+        else if (!strcmp(argv[i], "--input-delay"))
+        {
+            options.tuning.inputDelay = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--rollback"))
+        {
+            options.tuning.rollback = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--isa") && !selectIsa(argv[++i]))
+        {
+            return 1;
+        }
+    }
 
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, GAME_NAME);
     SetTargetFPS(FPS);
@@ -1250,22 +761,45 @@ int main()
     Player player1;
     Player player2;
 
-    mainMenu(&gameMode);
+    FrameScheduler scheduler;
+    if (options.connect)
+    {
+        // The host picked the game mode, and the session starts once it is known
+        joinGame(options.connect, &player1, &player2, &options, &scheduler, &profiler, &telemetry);
+    }
+    else
+    {
+        mainMenu(&gameMode, &scheduler);
+        ScheduleReport menuSchedule = scheduler.report();
 
-    game(&player1, &player2, &gameMode, &calculationTime);
+        if (options.host)
+        {
+            gameMode.numberOfPlayer = 2;
+            options.chaosBalls = 0;
+            options.tickRate = tickRateSet ? options.tickRate : NET_TICK_RATE;
+        }
+        Session session = {options.seed, gameMode, options.tickRate, options.chaosBalls};
+        if (!telemetry.open(options.telemetry, &session))
+        {
+            TraceLog(LOG_WARNING, "Cannot write telemetry to %s", options.telemetry);
+        }
 
-    CloseWindow();
+        telemetry.schedule("menu", &menuSchedule);
+
+        scheduler.restart();
+        if (options.host)
+        {
+            hostGame(&player1, &player2, &gameMode, &options, &scheduler, &profiler, &telemetry);
+        }
+        else
+        {
+            game(&player1, &player2, &gameMode, &options, &scheduler, &profiler, &telemetry);
+        }
+    }
 
-    double executionTime = time(NULL) - temporaryTime;
+    CloseWindow();
 
-    FILE *logFile = fopen("log.txt", "a");
-    fprintf(logFile,
-            "Execution time is %.0f seconds.\nCalculation time while using %s is %.9f nano seconds.\n",
-            executionTime,
-            (gameMode.program == Program::Cpp ? "C++" : "ASSEMBLY"),
-            calculationTime * 1000000000);
-    fclose(logFile);
+    telemetry.close(&profiler, (nanoseconds() - startTime) / 1e9);
 
     return 0;
 }
-
@@ -1,27 +1,22 @@
 #!/bin/bash
 
-rm *.out &>/dev/null
+rm game.out &>/dev/null
 rm *.o &>/dev/null
 
-nasm ASM/R.s -felf64 -o R.o &>/dev/null
-nasm ASM/S.s -felf64 -o S.o &>/dev/null
-nasm ASM/C.s -felf64 -o C.o &>/dev/null
-nasm ASM/G.s -felf64 -o G.o &>/dev/null
-nasm ASM/SE.s -felf64 -o SE.o &>/dev/null
-nasm ASM/SA.s -felf64 -o SA.o &>/dev/null
-nasm ASM/EA.s -felf64 -o EA.o &>/dev/null
-nasm ASM/EX.s -felf64 -o EX.o &>/dev/null
-nasm ASM/EY.s -felf64 -o EY.o &>/dev/null
+for kernel in R S C G SE SA EA EX EY RB CB SB SC GB
+do
+    nasm ASM/$kernel.s -felf64 -o $kernel.o || exit 1
+done
 
-g++ main.cpp R.o S.o C.o G.o SE.o SA.o EA.o EX.o EY.o -o game.out -lraylib -no-pie &>/dev/null
+g++ -O3 -ffp-contract=off -pthread game.cpp R.o S.o C.o G.o SE.o SA.o EA.o EX.o EY.o RB.o CB.o SB.o SC.o GB.o -o game.out -lraylib || exit 1
 
 echo "Let's play PONG!"
 
-./game.out &>/dev/null
+./game.out "$@"
 
 echo ":("
 
 rm *.o &>/dev/null
-rm *.out &>/dev/null
+rm game.out &>/dev/null
 
 sleep 2
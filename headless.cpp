@@ -0,0 +1,633 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "netplay.h"
+#include "profiler.h"
+#include "random.h"
+#include "replay.h"
+#include "simulation.h"
+#include "threadpool.h"
+
+// Plays complete matches without a window, so a Path/Difficulty/AI change
+// can be checked over thousands of seeded matches instead of by hand. The
+// right paddle is the game's AI, the left one is driven by --left. Matches
+// are independent, so they are spread over --threads workers, each with its
+// own Statistics; the results do not depend on the thread count.
+//
+//     ./headless.out [--matches N] [--seed N] [--threads N] [--path regular|sin|curve]
+//                    [--difficulty easy|medium|hard] [--program cpp|assembly]
+//                    [--left ai|sweep|idle] [--score N] [--tick-rate N]
+//                    [--max-seconds N] [--balls N] [--obstacles N]
+//                    [--format csv|json] [--record FILE] [--replay FILE]
+//                    [--net PORT] [--latency MS] [--jitter MS] [--loss PERCENT]
+//                    [--input-delay N] [--rollback N]
+//
+// Matches run at the game's TICK_RATE unless --tick-rate says otherwise, so
+// the results describe the physics the game runs; FPS is the old rate of
+// one tick per frame. --net defaults to NET_TICK_RATE instead. The rate
+// changes the results, not only the speed: the AI's reaction delay and
+// paddle steps, the sweeps against walls and paddles and the sin path's
+// frame count all advance a tick at a time, so an event lands a tick
+// earlier or later and every seeded random draw after it differs.
+//
+// A match costs its ticks, TICK_RATE / FPS times as many at the default as
+// at --tick-rate 60. The 10^5 matches a minute on one core holds only at
+// --tick-rate 60, and only for short rallies such as --left sweep or idle;
+// ai against ai rallies far longer and manages a few 10^4 even at 60, a
+// few 10^3 at TICK_RATE.
+//
+// --balls adds that many chaos mode balls to every match, to stress the
+// physics rather than the AI, and --obstacles lays out up to
+// OBSTACLE_COLUMNS * OBSTACLE_ROWS blocks for them to bounce off. --record plays the single match --seed and
+// saves it as a replay; --replay plays a replay back as fast as possible,
+// checks the final state against the recording and reports how many times
+// real time it ran. An explicit --program replays under the other program,
+// which makes the replay a benchmark rather than a check.
+//
+// --net plays the single match --seed over UDP on localhost instead: a
+// NetServer on PORT and a NetClient for each paddle, all in this process,
+// both clients played by the ai bot from what their snapshots show. Every
+// socket sends through the network simulator, so --latency is one way and
+// the round trip is twice that. It reports each peer's bandwidth and latency
+// per tick; --record saves the server's match, which --replay then checks.
+
+#define OBSTACLE_SIZE 40
+#define OBSTACLE_SPACING 80
+#define OBSTACLE_COLUMNS 12
+#define OBSTACLE_ROWS 8
+
+//STRUCTURS
+enum LeftPlayer
+{
+    LeftAI,
+    LeftSweep,
+    LeftIdle
+};
+
+typedef struct Options
+{
+    long matches;
+    unsigned long long seed;
+    int threads;
+    GameMode gameMode;
+    LeftPlayer left;
+    int scoreLimit;
+    int tickRate;
+    int maxSeconds;
+    int balls;
+    int obstacles;
+    bool json;
+    const char *record;
+    const char *replay;
+    bool programOverride;
+    bool tickRateOverride;
+    int netPort;
+    NetTuning tuning;
+} Options;
+
+//STATISTICS CLASS
+// One per worker thread, merged once all matches are done.
+class alignas(64) Statistics
+{
+public:
+    long matches;
+    long leftWins;
+    long rightWins;
+    long timeouts;
+    long points;
+    long hits;
+    long rallyHits;
+    long ticks;
+    Histogram rallies;
+
+    Statistics() : matches(0), leftWins(0), rightWins(0), timeouts(0), points(0), hits(0), rallyHits(0), ticks(0) {}
+
+    void merge(const Statistics &other)
+    {
+        matches += other.matches;
+        leftWins += other.leftWins;
+        rightWins += other.rightWins;
+        timeouts += other.timeouts;
+        points += other.points;
+        hits += other.hits;
+        rallyHits += other.rallyHits;
+        ticks += other.ticks;
+        rallies.merge(other.rallies);
+    }
+};
+
+//PLATFORM
+bool noKeyDown(void *context, int key)
+{
+    return false;
+}
+
+//MATCHES
+// Fills the middle of the court row by row, OBSTACLE_SPACING apart.
+void placeObstacles(Simulation *simulation, int count)
+{
+    float left = (SCREEN_WIDTH - OBSTACLE_COLUMNS * OBSTACLE_SPACING) / 2 + (OBSTACLE_SPACING - OBSTACLE_SIZE) / 2;
+    float top = (SCREEN_HEIGHT - OBSTACLE_ROWS * OBSTACLE_SPACING) / 2 + (OBSTACLE_SPACING - OBSTACLE_SIZE) / 2;
+    for (int i = 0; i < count; i++)
+    {
+        simulation->addObstacle(left + i % OBSTACLE_COLUMNS * OBSTACLE_SPACING, top + i / OBSTACLE_COLUMNS * OBSTACLE_SPACING,
+                                OBSTACLE_SIZE, OBSTACLE_SIZE);
+    }
+}
+
+// The left paddle's input for this tick.
+unsigned leftInput(Simulation *simulation, Options *options)
+{
+    LeftPaddle *paddle = simulation->getLeftPaddle();
+    Ball *ball = simulation->getBall();
+
+    switch (options->left)
+    {
+    case LeftAI:
+        if (ball->getX() < SCREEN_WIDTH / 2)
+        {
+            float center = paddle->getY() + paddle->getHeight() / 2;
+            float deadZone = 5.0f * FPS / options->tickRate;
+            if (center > ball->getY() + deadZone)
+            {
+                return InputW;
+            }
+            else if (center < ball->getY() - deadZone)
+            {
+                return InputS;
+            }
+        }
+        return 0;
+
+    case LeftSweep:
+        // Full up/down sweeps, one second each way
+        return (simulation->getTick() / options->tickRate) % 2 ? InputS : InputW;
+
+    default:
+        return 0;
+    }
+}
+
+// writer, when not NULL, records every tick of the match.
+void runMatch(unsigned long long seed, Options *options, Statistics *statistics, ReplayWriter *writer)
+{
+    Random random(seed);
+    Platform platform = {seededRandomValue, noKeyDown, &random};
+    Player player1;
+    Player player2;
+    GameMode gameMode = options->gameMode;
+    Simulation simulation(&gameMode, &player1, &player2, options->tickRate, options->balls, &platform, NULL);
+    placeObstacles(&simulation, options->obstacles);
+
+    long maxTicks = (long)options->maxSeconds * options->tickRate;
+    long rally = 0;
+
+    while (player1.getScore() < options->scoreLimit && player2.getScore() < options->scoreLimit &&
+           simulation.getTick() < maxTicks)
+    {
+        unsigned input = leftInput(&simulation, options);
+        if (writer)
+        {
+            writer->record(input, 1);
+        }
+        unsigned events = simulation.step(input);
+        if (events & EventHit)
+        {
+            rally++;
+            statistics->hits++;
+        }
+        if (events & EventPoint)
+        {
+            statistics->rallies.record(rally);
+            statistics->rallyHits += rally;
+            rally = 0;
+        }
+    }
+
+    if (writer)
+    {
+        writer->close(simulationChecksum(&simulation, &player1, &player2));
+    }
+
+    statistics->matches++;
+    statistics->points += player1.getScore() + player2.getScore();
+    statistics->ticks += simulation.getTick();
+    if (player1.getScore() >= options->scoreLimit)
+    {
+        statistics->leftWins++;
+    }
+    else if (player2.getScore() >= options->scoreLimit)
+    {
+        statistics->rightWins++;
+    }
+    else
+    {
+        statistics->timeouts++;
+    }
+}
+
+void printStatistics(Options *options, Statistics *statistics, double seconds)
+{
+    double meanRally = statistics->rallies.getCount() ? (double)statistics->rallyHits / statistics->rallies.getCount() : 0;
+    double matchesPerSecond = seconds > 0 ? statistics->matches / seconds : 0;
+
+    if (options->json)
+    {
+        printf("{\"seed\": %llu, \"matches\": %ld, \"left_wins\": %ld, \"right_wins\": %ld, \"timeouts\": %ld, "
+               "\"points\": %ld, \"mean_rally\": %.3f, \"rally_p50\": %llu, \"rally_p99\": %llu, \"rally_max\": %llu, "
+               "\"ticks\": %ld, \"seconds\": %.3f, \"matches_per_second\": %.1f, \"matches_per_minute\": %.0f}\n",
+               options->seed, statistics->matches, statistics->leftWins, statistics->rightWins, statistics->timeouts,
+               statistics->points, meanRally,
+               (unsigned long long)statistics->rallies.percentile(0.50),
+               (unsigned long long)statistics->rallies.percentile(0.99),
+               (unsigned long long)statistics->rallies.getMax(),
+               statistics->ticks, seconds, matchesPerSecond, matchesPerSecond * 60);
+    }
+    else
+    {
+        printf("seed,matches,left_wins,right_wins,timeouts,points,mean_rally,rally_p50,rally_p99,rally_max,"
+               "ticks,seconds,matches_per_second,matches_per_minute\n");
+        printf("%llu,%ld,%ld,%ld,%ld,%ld,%.3f,%llu,%llu,%llu,%ld,%.3f,%.1f,%.0f\n",
+               options->seed, statistics->matches, statistics->leftWins, statistics->rightWins, statistics->timeouts,
+               statistics->points, meanRally,
+               (unsigned long long)statistics->rallies.percentile(0.50),
+               (unsigned long long)statistics->rallies.percentile(0.99),
+               (unsigned long long)statistics->rallies.getMax(),
+               statistics->ticks, seconds, matchesPerSecond, matchesPerSecond * 60);
+    }
+}
+
+// The --left ai for whichever paddle client plays, from what it shows.
+unsigned netBot(NetClient *client, Options *options)
+{
+    bool coming = client->getPlayer() == 0 ? client->getBallX() < SCREEN_WIDTH / 2 : client->getBallX() > SCREEN_WIDTH / 2;
+    float center = client->getPaddleCenter();
+    float deadZone = 5.0f * FPS / options->tickRate;
+    if (coming && center > client->getBallY() + deadZone)
+    {
+        return InputW;
+    }
+    if (coming && center < client->getBallY() - deadZone)
+    {
+        return InputS;
+    }
+    return 0;
+}
+
+void printNetReport(Options *options, const char *role, const NetReport *report, int leftScore, int rightScore)
+{
+    if (options->json)
+    {
+        printf("{\"role\": \"%s\", \"ticks\": %llu, \"left_score\": %d, \"right_score\": %d, "
+               "\"sent_bytes_per_tick\": %.1f, \"received_bytes_per_tick\": %.1f, \"packets_sent\": %llu, "
+               "\"packets_received\": %llu, \"packets_dropped\": %llu, \"full_snapshots\": %llu, "
+               "\"delta_snapshots\": %llu, \"missed_inputs\": %llu, \"late_inputs\": %llu, \"corrections\": %llu, "
+               "\"max_correction_px\": %.3f, \"predicted_ticks\": %d, \"input_slack\": %d, \"rtt_p50_ms\": %.2f, "
+               "\"rtt_p99_ms\": %.2f, \"rtt_max_ms\": %.2f}\n",
+               role, (unsigned long long)report->ticks, leftScore, rightScore, report->sentPerTick,
+               report->receivedPerTick, (unsigned long long)report->packetsSent,
+               (unsigned long long)report->packetsReceived, (unsigned long long)report->packetsDropped,
+               (unsigned long long)report->fullSnapshots, (unsigned long long)report->deltaSnapshots,
+               (unsigned long long)report->missedInputs, (unsigned long long)report->lateInputs,
+               (unsigned long long)report->corrections, report->maxCorrection, report->predicted, report->slack,
+               report->roundTripP50 / 1e6, report->roundTripP99 / 1e6, report->roundTripMax / 1e6);
+    }
+    else
+    {
+        printf("%s,%llu,%d,%d,%.1f,%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.3f,%d,%d,%.2f,%.2f,%.2f\n",
+               role, (unsigned long long)report->ticks, leftScore, rightScore, report->sentPerTick,
+               report->receivedPerTick, (unsigned long long)report->packetsSent,
+               (unsigned long long)report->packetsReceived, (unsigned long long)report->packetsDropped,
+               (unsigned long long)report->fullSnapshots, (unsigned long long)report->deltaSnapshots,
+               (unsigned long long)report->missedInputs, (unsigned long long)report->lateInputs,
+               (unsigned long long)report->corrections, report->maxCorrection, report->predicted, report->slack,
+               report->roundTripP50 / 1e6, report->roundTripP99 / 1e6, report->roundTripMax / 1e6);
+    }
+}
+
+// Plays --seed over localhost in real time, until a client sees the score
+// limit or --max-seconds pass; false when the sockets cannot be opened.
+bool playNet(Options *options)
+{
+    Random random(options->seed);
+    Platform platform = {seededRandomValue, noKeyDown, &random};
+    Player player1;
+    Player player2;
+    GameMode gameMode = options->gameMode;
+    gameMode.numberOfPlayer = 2;
+    Simulation simulation(&gameMode, &player1, &player2, options->tickRate, 0, &platform, NULL);
+    ReplayWriter writer;
+    if (options->record && !writer.open(options->record, options->seed, &gameMode, options->tickRate, 0))
+    {
+        fprintf(stderr, "%s: cannot write\n", options->record);
+        return false;
+    }
+
+    NetServer server(&simulation, &player1, &player2, &gameMode, options->tickRate, options->record ? &writer : NULL, NULL);
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%d", options->netPort);
+    NetClient clients[2] = {NetClient(options->tuning, NULL), NetClient(options->tuning, NULL)};
+    if (!server.open(options->netPort, options->tuning.conditions, options->seed) ||
+        !clients[0].open(address, options->seed + 1) || !clients[1].open(address, options->seed + 2))
+    {
+        fprintf(stderr, "cannot play on port %d\n", options->netPort);
+        return false;
+    }
+    server.start();
+
+    uint64_t deadline = nanoseconds() + (uint64_t)options->maxSeconds * 1000000000ull;
+    while (nanoseconds() < deadline && !clients[0].hasEnded() && !clients[1].hasEnded() &&
+           clients[0].getLeftScore() < options->scoreLimit && clients[0].getRightScore() < options->scoreLimit)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            clients[c].update(netBot(&clients[c], options));
+        }
+        clients[0].wait(0.001);
+    }
+    for (int c = 0; c < 2; c++)
+    {
+        clients[c].close();
+    }
+    server.stop();
+    if (options->record)
+    {
+        writer.close(simulationChecksum(&simulation, &player1, &player2));
+    }
+
+    if (!options->json)
+    {
+        printf("role,ticks,left_score,right_score,sent_bytes_per_tick,received_bytes_per_tick,packets_sent,"
+               "packets_received,packets_dropped,full_snapshots,delta_snapshots,missed_inputs,late_inputs,corrections,"
+               "max_correction_px,predicted_ticks,input_slack,rtt_p50_ms,rtt_p99_ms,rtt_max_ms\n");
+    }
+    NetReport report = server.getTotal();
+    printNetReport(options, "server", &report, player1.getScore(), player2.getScore());
+    for (int c = 0; c < 2; c++)
+    {
+        report = clients[c].getTotal();
+        printNetReport(options, clients[c].getPlayer() == 0 ? "left" : "right", &report, player1.getScore(),
+                       player2.getScore());
+    }
+    return true;
+}
+
+// Plays options->replay back; returns false when it cannot be read or does not match.
+bool playReplay(Options *options)
+{
+    ReplayReader reader;
+    if (!reader.open(options->replay))
+    {
+        fprintf(stderr, "%s: not a replay\n", options->replay);
+        return false;
+    }
+
+    GameMode gameMode = reader.getGameMode();
+    if (options->programOverride)
+    {
+        gameMode.program = options->gameMode.program;
+    }
+    Random random(reader.getSeed());
+    Platform platform = {seededRandomValue, noKeyDown, &random};
+    Player player1;
+    Player player2;
+    Simulation simulation(&gameMode, &player1, &player2, reader.getTickRate(), reader.getChaosBalls(), &platform, NULL);
+
+    uint64_t start = nanoseconds();
+    unsigned input;
+    while (reader.next(&input))
+    {
+        simulation.step(input);
+    }
+    double seconds = (nanoseconds() - start) / 1e9;
+
+    long ticks = simulation.getTick();
+    double simulated = (double)ticks / reader.getTickRate();
+    double realTime = seconds > 0 ? simulated / seconds : 0;
+    uint64_t checksum = simulationChecksum(&simulation, &player1, &player2);
+    bool checked = reader.hasChecksum() && gameMode.program == reader.getGameMode().program;
+    bool match = !checked || (checksum == reader.getChecksum() && (uint64_t)ticks == reader.getTicks());
+    const char *result = !checked ? "unchecked" : match ? "match" : "mismatch";
+
+    if (options->json)
+    {
+        printf("{\"replay\": \"%s\", \"program\": \"%s\", \"ticks\": %ld, \"left_score\": %d, \"right_score\": %d, "
+               "\"checksum\": \"%016llx\", \"result\": \"%s\", \"seconds\": %.3f, \"times_real_time\": %.0f}\n",
+               options->replay, gameMode.program == Program::Cpp ? "cpp" : "assembly", ticks,
+               player1.getScore(), player2.getScore(), (unsigned long long)checksum, result, seconds, realTime);
+    }
+    else
+    {
+        printf("replay,program,ticks,left_score,right_score,checksum,result,seconds,times_real_time\n");
+        printf("%s,%s,%ld,%d,%d,%016llx,%s,%.3f,%.0f\n",
+               options->replay, gameMode.program == Program::Cpp ? "cpp" : "assembly", ticks,
+               player1.getScore(), player2.getScore(), (unsigned long long)checksum, result, seconds, realTime);
+    }
+    return match;
+}
+
+bool parseOptions(int argc, char **argv, Options *options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        const char *value = hasValue ? argv[i + 1] : "";
+
+        if (!strcmp(argv[i], "--matches") && hasValue)
+        {
+            options->matches = atol(value);
+        }
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+        {
+            options->seed = strtoull(value, NULL, 10);
+        }
+        else if (!strcmp(argv[i], "--threads") && hasValue)
+        {
+            options->threads = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--path") && hasValue)
+        {
+            options->gameMode.path = !strcmp(value, "sin") ? Path::Sin : !strcmp(value, "curve") ? Path::Curve
+                                                                                                 : Path::Regular;
+        }
+        else if (!strcmp(argv[i], "--difficulty") && hasValue)
+        {
+            options->gameMode.difficulty = !strcmp(value, "medium") ? Difficulty::Meduim : !strcmp(value, "hard") ? Difficulty::Hard
+                                                                                                                  : Difficulty::Easy;
+        }
+        else if (!strcmp(argv[i], "--program") && hasValue)
+        {
+            options->gameMode.program = !strcmp(value, "assembly") ? Program::Assembly : Program::Cpp;
+            options->programOverride = true;
+        }
+        else if (!strcmp(argv[i], "--left") && hasValue)
+        {
+            options->left = !strcmp(value, "sweep") ? LeftSweep : !strcmp(value, "idle") ? LeftIdle
+                                                                                        : LeftAI;
+        }
+        else if (!strcmp(argv[i], "--score") && hasValue)
+        {
+            options->scoreLimit = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--tick-rate") && hasValue)
+        {
+            options->tickRate = atoi(value);
+            options->tickRateOverride = true;
+        }
+        else if (!strcmp(argv[i], "--max-seconds") && hasValue)
+        {
+            options->maxSeconds = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--balls") && hasValue)
+        {
+            options->balls = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--obstacles") && hasValue)
+        {
+            options->obstacles = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--record") && hasValue)
+        {
+            options->record = value;
+        }
+        else if (!strcmp(argv[i], "--replay") && hasValue)
+        {
+            options->replay = value;
+        }
+        else if (!strcmp(argv[i], "--format") && hasValue)
+        {
+            options->json = !strcmp(value, "json");
+        }
+        else if (!strcmp(argv[i], "--net") && hasValue)
+        {
+            options->netPort = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--latency") && hasValue)
+        {
+            options->tuning.conditions.latency = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--jitter") && hasValue)
+        {
+            options->tuning.conditions.jitter = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--loss") && hasValue)
+        {
+            options->tuning.conditions.loss = atof(value) / 100;
+        }
+        else if (!strcmp(argv[i], "--input-delay") && hasValue)
+        {
+            options->tuning.inputDelay = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--rollback") && hasValue)
+        {
+            options->tuning.rollback = atoi(value);
+        }
+        else if (!strcmp(argv[i], "--isa") && hasValue)
+        {
+            if (!selectIsa(value))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--matches N] [--seed N] [--threads N] [--path regular|sin|curve] "
+                            "[--difficulty easy|medium|hard] [--program cpp|assembly] [--left ai|sweep|idle] "
+                            "[--score N] [--tick-rate N] [--max-seconds N] [--balls N] [--obstacles N] "
+                            "[--format csv|json] [--record FILE] [--replay FILE] [--isa scalar|sse|avx2|fma|avx512] "
+                            "[--net PORT] [--latency MS] [--jitter MS] [--loss PERCENT] [--input-delay N] [--rollback N]\n",
+                    argv[0]);
+            return false;
+        }
+        i++;
+    }
+    if (!options->tickRateOverride && options->netPort)
+    {
+        options->tickRate = NET_TICK_RATE;
+    }
+    return options->matches > 0 && options->matches <= UINT32_MAX &&
+           options->scoreLimit > 0 && options->tickRate > 0 && options->maxSeconds > 0 && options->balls >= 0 &&
+           options->obstacles >= 0 && options->obstacles <= OBSTACLE_COLUMNS * OBSTACLE_ROWS &&
+           options->netPort >= 0 && options->netPort <= 65535;
+}
+
+int main(int argc, char **argv)
+{
+    Options options = {
+        .matches = 10000,
+        .seed = 1,
+        .threads = (int)std::thread::hardware_concurrency(),
+        .gameMode = {1, Path::Regular, Difficulty::Easy, Program::Cpp},
+        .left = LeftAI,
+        .scoreLimit = 5,
+        .tickRate = TICK_RATE,
+        .maxSeconds = 600,
+        .balls = 0,
+        .obstacles = 0,
+        .json = false,
+        .record = NULL,
+        .replay = NULL,
+        .programOverride = false,
+        .tickRateOverride = false,
+        .netPort = 0,
+        .tuning = {NET_DELAY, NET_ROLLBACK, {0, 0, 0}}};
+
+    if (!parseOptions(argc, argv, &options))
+    {
+        return 1;
+    }
+
+    if (options.replay)
+    {
+        return playReplay(&options) ? 0 : 1;
+    }
+
+    if (options.netPort)
+    {
+        return playNet(&options) ? 0 : 1;
+    }
+
+    if (options.record)
+    {
+        if (options.obstacles)
+        {
+            fprintf(stderr, "--obstacles cannot be recorded, replays do not store them\n");
+            return 1;
+        }
+        ReplayWriter writer;
+        if (!writer.open(options.record, options.seed, &options.gameMode, options.tickRate, options.balls))
+        {
+            fprintf(stderr, "%s: cannot write\n", options.record);
+            return 1;
+        }
+        Statistics statistics;
+        uint64_t start = nanoseconds();
+        runMatch(options.seed, &options, &statistics, &writer);
+        printStatistics(&options, &statistics, (nanoseconds() - start) / 1e9);
+        return 0;
+    }
+
+    if (options.threads <= 0)
+    {
+        options.threads = 1;
+    }
+
+    ThreadPool pool(options.threads);
+    std::vector<Statistics> perThread(pool.getThreads());
+
+    uint64_t start = nanoseconds();
+    pool.parallelFor((uint32_t)options.matches, [&](uint32_t match, int worker) {
+        runMatch(options.seed + match, &options, &perThread[worker], NULL);
+    });
+    double seconds = (nanoseconds() - start) / 1e9;
+
+    Statistics statistics;
+    for (size_t i = 0; i < perThread.size(); i++)
+    {
+        statistics.merge(perThread[i]);
+    }
+
+    printStatistics(&options, &statistics, seconds);
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+rm headless.out &>/dev/null
+rm *.o &>/dev/null
+
+for kernel in R S C G SE SA EA EX EY RB CB SB SC GB
+do
+    nasm ASM/$kernel.s -felf64 -o $kernel.o || exit 1
+done
+
+g++ -O3 -ffp-contract=off -pthread headless.cpp R.o S.o C.o G.o SE.o SA.o EA.o EX.o EY.o RB.o CB.o SB.o SC.o GB.o -o headless.out || exit 1
+
+./headless.out "$@"
+
+rm *.o &>/dev/null
+rm headless.out &>/dev/null
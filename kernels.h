@@ -0,0 +1,489 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "cpu.h"
+
+// The hot-path math shared by the game and the headless tools. Every kernel
+// has a C++ version and an Assembly version from ASM/, picked by
+// gameMode->program. Nothing in here depends on raylib.
+
+#define SCREEN_WIDTH 1280
+#define SCREEN_HEIGHT 800
+#define FPS 60
+
+#ifndef PI
+#define PI 3.14159265358979323846f
+#endif
+
+extern "C" float R(int velocity);
+extern "C" float S(int velocity, int time);
+extern "C" float C(int positionX, int positionY);
+extern "C" int G(int color, float i);
+extern "C" float SE(int i);
+extern "C" float SA(float rotationAngle, float segment);
+extern "C" float EA(float rotationAngle, float segment);
+extern "C" float EX(float positionX, float radius, float startAngle);
+extern "C" float EY(float positionY, float radius, float startAngle);
+
+extern "C" void R_batch(const int *velocity, float *out, size_t n);
+extern "C" void R_batch_avx2(const int *velocity, float *out, size_t n);
+extern "C" void R_batch_avx512(const int *velocity, float *out, size_t n);
+extern "C" void C_batch(const int *positionX, const int *positionY, float *out, size_t n);
+extern "C" void C_batch_avx2(const int *positionX, const int *positionY, float *out, size_t n);
+extern "C" void C_batch_avx512(const int *positionX, const int *positionY, float *out, size_t n);
+extern "C" void S_batch(const int *velocity, const int *time, float *out, size_t n);
+extern "C" void S_batch_avx2(const int *velocity, const int *time, float *out, size_t n);
+extern "C" void S_batch_avx512(const int *velocity, const int *time, float *out, size_t n);
+extern "C" void SINCOS(float angle, float *sine, float *cosine);
+extern "C" void SINCOS_batch(const float *angle, float *sine, float *cosine, size_t n);
+extern "C" void SINCOS_batch_avx2(const float *angle, float *sine, float *cosine, size_t n);
+extern "C" void SINCOS_batch_fma(const float *angle, float *sine, float *cosine, size_t n);
+extern "C" void SINCOS_batch_avx512(const float *angle, float *sine, float *cosine, size_t n);
+extern "C" void G_rgba_batch(unsigned color, const float *radius, unsigned *out, size_t n, float outerRadius, float scale);
+
+
+//STRUCTURS
+enum Path
+{
+    Regular,
+    Sin,
+    Curve
+};
+
+enum Difficulty
+{
+    Easy,
+    Meduim,
+    Hard
+};
+
+enum Program
+{
+    Cpp,
+    Assembly
+};
+
+typedef struct GameMode
+{
+    int numberOfPlayer;
+    Path path;
+    Difficulty difficulty;
+    Program program;
+} GameMode;
+
+
+//KERNEL TABLE
+// The Assembly kernels, bound once to the variants for an Isa. Every variant
+// of a kernel the simulation uses gives bit-identical results, so a replay
+// plays back the same on any machine; the FMA sincos rounds differently and
+// is only bound to sincosBatch, which is only used for drawing. R, S, C and
+// G have one scalar version for every tier, and G_rgba_batch one SSE2
+// version.
+typedef struct KernelTable
+{
+    Isa isa;
+    float (*regular)(int velocity);
+    float (*sin)(int velocity, int time);
+    float (*curve)(int positionX, int positionY);
+    int (*gradient)(int color, float i);
+    void (*regularBatch)(const int *velocity, float *out, size_t n);
+    void (*sinBatch)(const int *velocity, const int *time, float *out, size_t n);
+    void (*curveBatch)(const int *positionX, const int *positionY, float *out, size_t n);
+    void (*sincosBatch)(const float *angle, float *sine, float *cosine, size_t n);
+    void (*gradientBatch)(unsigned color, const float *radius, unsigned *out, size_t n, float outerRadius, float scale);
+} KernelTable;
+
+// The batch kernels one element per call, for IsaScalar.
+inline void regularBatchScalar(const int *velocity, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = R(velocity[i]);
+    }
+}
+
+inline void sinBatchScalar(const int *velocity, const int *time, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = S(velocity[i], time[i]);
+    }
+}
+
+inline void curveBatchScalar(const int *positionX, const int *positionY, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = C(positionX[i], positionY[i]);
+    }
+}
+
+inline void sincosBatchScalar(const float *angle, float *sine, float *cosine, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        SINCOS(angle[i], &sine[i], &cosine[i]);
+    }
+}
+
+inline KernelTable kernelTable(Isa isa)
+{
+    KernelTable table = {isa, R, S, C, G, regularBatchScalar, sinBatchScalar, curveBatchScalar,
+                         sincosBatchScalar, G_rgba_batch};
+    if (isa >= IsaSse)
+    {
+        table.regularBatch = R_batch;
+        table.sinBatch = S_batch;
+        table.curveBatch = C_batch;
+        table.sincosBatch = SINCOS_batch;
+    }
+    if (isa >= IsaAvx2)
+    {
+        table.regularBatch = R_batch_avx2;
+        table.sinBatch = S_batch_avx2;
+        table.curveBatch = C_batch_avx2;
+        table.sincosBatch = SINCOS_batch_avx2;
+    }
+    if (isa >= IsaFma)
+    {
+        table.sincosBatch = SINCOS_batch_fma;
+    }
+    if (isa >= IsaAvx512)
+    {
+        table.regularBatch = R_batch_avx512;
+        table.sinBatch = S_batch_avx512;
+        table.curveBatch = C_batch_avx512;
+        table.sincosBatch = SINCOS_batch_avx512;
+    }
+    return table;
+}
+
+inline KernelTable asmKernels = kernelTable(preferredIsa());
+
+// Call it before any other thread runs a kernel.
+inline void useIsa(Isa isa)
+{
+    asmKernels = kernelTable(isa);
+}
+
+// For --isa: false, with a message, when this CPU lacks name.
+inline bool selectIsa(const char *name)
+{
+    Isa isa;
+    if (!parseIsa(name, &isa))
+    {
+        fprintf(stderr, "unknown isa %s, expected scalar, sse, avx2, fma or avx512\n", name);
+        return false;
+    }
+    CpuFeatures features = detectCpu();
+    if (!isaSupported(&features, isa))
+    {
+        fprintf(stderr, "this CPU does not support %s, the best it has is %s\n", name, isaName(bestIsa(&features)));
+        return false;
+    }
+    useIsa(isa);
+    return true;
+}
+
+//PROGRAM POLICIES
+// The path kernels of each Program as static members, for code that picks
+// its Program once and is then compiled against it (see Simulation::tickAs()),
+// so nothing in its inner loop branches on gameMode->program. The batch
+// versions take n balls at a time. The C++ regular and curve loops are
+// branch-free so the compiler can vectorize them the way RB.s and CB.s are;
+// the sin loop calls the scalar double sin() per ball and stays scalar.
+struct CppKernels
+{
+    static const Program program = Program::Cpp;
+
+    static float regularPath(int velocity)
+    {
+        return velocity / (float)FPS;
+    }
+
+    static float sinPath(int velocity, int time)
+    {
+        const float frequency = 0.05f;
+        float baseMovement = velocity / (float)FPS;
+        float sineComponent = sin(frequency * time);
+        return baseMovement * sineComponent;
+    }
+
+    static float curvePath(int positionX, int positionY)
+    {
+        const float constant = 1000;
+        positionX -= SCREEN_WIDTH / 2;
+        positionY -= SCREEN_HEIGHT / 2;
+        float norm = positionX * positionX + positionY * positionY;
+        if (norm < 25)
+        {
+            return 0;
+        }
+        else
+        {
+            return constant * positionY / norm;
+        }
+    }
+
+    static void regularPathBatch(const int *velocity, float *out, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = velocity[i] / (float)FPS;
+        }
+    }
+
+    static void sinPathBatch(const int *velocity, const int *time, float *out, size_t n)
+    {
+        const float frequency = 0.05f;
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = velocity[i] / (float)FPS * sin(frequency * time[i]);
+        }
+    }
+
+    static void curvePathBatch(const int *positionX, const int *positionY, float *out, size_t n)
+    {
+        const float constant = 1000;
+        for (size_t i = 0; i < n; i++)
+        {
+            float x = positionX[i] - SCREEN_WIDTH / 2;
+            float y = positionY[i] - SCREEN_HEIGHT / 2;
+            float norm = x * x + y * y;
+            float curve = constant * y / norm;
+            out[i] = norm < 25 ? 0 : curve;
+        }
+    }
+};
+
+struct AssemblyKernels
+{
+    static const Program program = Program::Assembly;
+
+    static float regularPath(int velocity)
+    {
+        return asmKernels.regular(velocity);
+    }
+
+    static float sinPath(int velocity, int time)
+    {
+        return asmKernels.sin(velocity, time);
+    }
+
+    static float curvePath(int positionX, int positionY)
+    {
+        return asmKernels.curve(positionX, positionY);
+    }
+
+    static void regularPathBatch(const int *velocity, float *out, size_t n)
+    {
+        asmKernels.regularBatch(velocity, out, n);
+    }
+
+    static void sinPathBatch(const int *velocity, const int *time, float *out, size_t n)
+    {
+        asmKernels.sinBatch(velocity, time, out, n);
+    }
+
+    static void curvePathBatch(const int *positionX, const int *positionY, float *out, size_t n)
+    {
+        asmKernels.curveBatch(positionX, positionY, out, n);
+    }
+};
+
+//PATH KERNELS
+inline float regularPath(int velocity, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        return CppKernels::regularPath(velocity);
+    }
+    else
+    {
+        return AssemblyKernels::regularPath(velocity);
+    }
+}
+
+inline float sinPath(int velocity, int time, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        return CppKernels::sinPath(velocity, time);
+    }
+    else
+    {
+        return AssemblyKernels::sinPath(velocity, time);
+    }
+}
+
+inline float curvePath(int positionX, int positionY, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        return CppKernels::curvePath(positionX, positionY);
+    }
+    else
+    {
+        return AssemblyKernels::curvePath(positionX, positionY);
+    }
+}
+
+//BATCH PATH KERNELS
+inline void regularPathBatch(const int *velocity, float *out, size_t n, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        CppKernels::regularPathBatch(velocity, out, n);
+    }
+    else
+    {
+        AssemblyKernels::regularPathBatch(velocity, out, n);
+    }
+}
+
+inline void sinPathBatch(const int *velocity, const int *time, float *out, size_t n, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        CppKernels::sinPathBatch(velocity, time, out, n);
+    }
+    else
+    {
+        AssemblyKernels::sinPathBatch(velocity, time, out, n);
+    }
+}
+
+inline void curvePathBatch(const int *positionX, const int *positionY, float *out, size_t n, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        CppKernels::curvePathBatch(positionX, positionY, out, n);
+    }
+    else
+    {
+        AssemblyKernels::curvePathBatch(positionX, positionY, out, n);
+    }
+}
+
+inline void sincosBatch(const float *angle, float *sine, float *cosine, size_t n, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            sine[i] = sin(angle[i]);
+            cosine[i] = cos(angle[i]);
+        }
+    }
+    else
+    {
+        asmKernels.sincosBatch(angle, sine, cosine, n);
+    }
+}
+
+//DRAW KERNELS
+// Geometry of the i-th of the six sectors of the ball's pinwheel.
+inline void ballSegment(int i, float rotationAngle, float positionX, float positionY, float radius, GameMode *gameMode,
+                        float *startAngle, float *endAngle, float *endX, float *endY)
+{
+    float segment;
+
+    if (gameMode->program == Program::Cpp)
+    {
+        segment = i * PI / 3;
+        *startAngle = rotationAngle + segment;
+        *endAngle = rotationAngle + segment + PI / 3;
+        *endX = positionX + radius * cos(*startAngle);
+        *endY = positionY + radius * sin(*startAngle);
+    }
+    else
+    {
+        segment = SE(i);
+        *startAngle = SA(rotationAngle, segment);
+        *endAngle = EA(rotationAngle, segment);
+        *endX = EX(positionX, radius, *startAngle);
+        *endY = EY(positionY, radius, *startAngle);
+    }
+}
+
+// All six sectors at once; in Assembly mode the end points of every sector
+// come out of a single sincos batch call.
+inline void ballSegments(float rotationAngle, float positionX, float positionY, float radius, GameMode *gameMode,
+                         float *startAngle, float *endAngle, float *endX, float *endY)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            ballSegment(i, rotationAngle, positionX, positionY, radius, gameMode,
+                        &startAngle[i], &endAngle[i], &endX[i], &endY[i]);
+        }
+    }
+    else
+    {
+        float sine[6];
+        float cosine[6];
+        for (int i = 0; i < 6; i++)
+        {
+            float segment = SE(i);
+            startAngle[i] = SA(rotationAngle, segment);
+            endAngle[i] = EA(rotationAngle, segment);
+        }
+        asmKernels.sincosBatch(startAngle, sine, cosine, 6);
+        for (int i = 0; i < 6; i++)
+        {
+            endX[i] = positionX + radius * cosine[i];
+            endY[i] = positionY + radius * sine[i];
+        }
+    }
+}
+
+// A whole radial gradient at once. color and out are packed RGBA8 (r in the
+// lowest byte, the memory layout of a raylib Color). Ring k gets r, g and b
+// raised by (outerRadius - radius[k]) * scale, truncated and saturating at
+// 255, and keeps color's alpha; rings past outerRadius keep color as is.
+// With outerRadius 128 and scale 0.5 it is three gradient() calls per ring.
+inline void gradientBatch(unsigned color, const float *radius, unsigned *out, size_t n,
+                          float outerRadius, float scale, GameMode *gameMode)
+{
+    if (gameMode->program == Program::Cpp)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            float offset = (outerRadius - radius[i]) * scale;
+            offset = offset < 0 ? 0 : offset > 255 ? 255 : offset;
+            unsigned add = (unsigned)offset;
+            unsigned result = color & 0xFF000000u;
+            for (int shift = 0; shift < 24; shift += 8)
+            {
+                unsigned channel = ((color >> shift) & 0xFF) + add;
+                result |= (channel > 255 ? 255 : channel) << shift;
+            }
+            out[i] = result;
+        }
+    }
+    else
+    {
+        asmKernels.gradientBatch(color, radius, out, n, outerRadius, scale);
+    }
+}
+
+// One color channel of the center circle's gradient at ring radius i.
+inline int gradient(int color, float i, GameMode *gameMode)
+{
+    const int radius = 128;
+
+    if (gameMode->program == Program::Cpp)
+    {
+        return (unsigned char)fmin(color + (radius - i) * 0.5, 255);
+    }
+    else
+    {
+        return asmKernels.gradient(color, i);
+    }
+}
+
+#endif
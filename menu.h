@@ -0,0 +1,411 @@
+#ifndef MENU_H
+#define MENU_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "raylib.h"
+#include "kernels.h"
+#include "rendercache.h"
+#include "textrenderer.h"
+
+// Retained, table-driven menus. A Menu is built once from a table of
+// WidgetSpecs and keeps every widget's state from then on. Options belong
+// to radio groups, and a group only remembers which option is selected, so
+// selecting one costs the same however many there are; the first option of
+// every group starts selected. Input comes in as MenuEvents and dispatch()
+// hands each to one widget: clicks through a grid over the screen listing
+// the widgets that overlap each cell, Tab and Enter through the focus,
+// which moves over options and buttons in table order. A state change only
+// marks the widget dirty. update() repaints the dirty rectangle of a cached
+// canvas and nothing else, with the titles of every widget it repaints in
+// one textRenderer batch, and draw() blits the canvas, so an idle menu
+// costs one texture draw per frame.
+
+#define MENU_WIDGETS 64
+#define MENU_GROUPS 16
+#define MENU_CELL 80
+#define MENU_COLUMNS ((SCREEN_WIDTH + MENU_CELL - 1) / MENU_CELL)
+#define MENU_ROWS ((SCREEN_HEIGHT + MENU_CELL - 1) / MENU_CELL)
+#define MENU_CELLS (MENU_COLUMNS * MENU_ROWS)
+#define MENU_FONT 20
+
+//STRUCTURS
+enum class WidgetKind
+{
+    Heading,
+    Label,
+    Option,
+    Button
+};
+
+// x is the widget's center and y its top, as for the other UI classes. An
+// Option selects value in group; a Button's value is what dispatch()
+// returns when it is pressed.
+typedef struct WidgetSpec
+{
+    WidgetKind kind;
+    int x;
+    int y;
+    const char *title;
+    int group;
+    int value;
+} WidgetSpec;
+
+typedef struct MenuStyle
+{
+    Color background;
+    Color heading;
+    Color label;
+    Color text;
+    Color focus;
+    Color normal;
+    Color unchecked;
+    Color checked;
+    Color button;
+} MenuStyle;
+
+enum class MenuEventType
+{
+    Click,
+    Next,
+    Activate
+};
+
+typedef struct MenuEvent
+{
+    MenuEventType type;
+    float x;
+    float y;
+} MenuEvent;
+
+//MENU CLASS
+class Menu
+{
+private:
+    typedef struct Widget
+    {
+        WidgetSpec spec;
+        Rectangle bounds;
+        int titleWidth;
+    } Widget;
+
+    Widget widgets[MENU_WIDGETS];
+    int count;
+    int selected[MENU_GROUPS];
+    int focus;
+    MenuStyle style;
+
+    int cellStart[MENU_CELLS + 1];
+    int *cellWidgets;
+
+    RenderCache canvas;
+    Rectangle dirty;
+    bool isDirty;
+
+    static bool contains(Rectangle rectangle, float x, float y)
+    {
+        return x >= rectangle.x && x < rectangle.x + rectangle.width &&
+               y >= rectangle.y && y < rectangle.y + rectangle.height;
+    }
+
+    static bool overlaps(Rectangle a, Rectangle b)
+    {
+        return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+    }
+
+    static int clampCell(float position, int cells)
+    {
+        int cell = (int)(position / MENU_CELL);
+        return cell < 0 ? 0 : cell >= cells ? cells - 1 : cell;
+    }
+
+    static bool interactive(const Widget *widget)
+    {
+        return widget->spec.kind == WidgetKind::Option || widget->spec.kind == WidgetKind::Button;
+    }
+
+    // Everything the widget draws, which is also where it can be clicked.
+    static Rectangle widgetBounds(const WidgetSpec *spec, int titleWidth)
+    {
+        switch (spec->kind)
+        {
+        case WidgetKind::Option:
+            return Rectangle{(float)spec->x - 15, (float)spec->y, (float)50 + titleWidth, 30};
+        case WidgetKind::Button:
+            return Rectangle{(float)spec->x - 50, (float)spec->y, 100, 30};
+        default:
+            return Rectangle{(float)spec->x - titleWidth / 2, (float)spec->y, (float)titleWidth, MENU_FONT};
+        }
+    }
+
+    // Counting sort of the interactive widgets into the cells they overlap.
+    void buildIndex()
+    {
+        memset(cellStart, 0, sizeof(cellStart));
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (!interactive(&widgets[i]))
+                {
+                    continue;
+                }
+                Rectangle bounds = widgets[i].bounds;
+                for (int r = clampCell(bounds.y, MENU_ROWS); r <= clampCell(bounds.y + bounds.height, MENU_ROWS); r++)
+                {
+                    for (int c = clampCell(bounds.x, MENU_COLUMNS); c <= clampCell(bounds.x + bounds.width, MENU_COLUMNS); c++)
+                    {
+                        int cell = r * MENU_COLUMNS + c;
+                        if (pass == 0)
+                        {
+                            cellStart[cell + 1]++;
+                        }
+                        else
+                        {
+                            cellWidgets[cellStart[cell]++] = i;
+                        }
+                    }
+                }
+            }
+            if (pass == 0)
+            {
+                for (int c = 0; c < MENU_CELLS; c++)
+                {
+                    cellStart[c + 1] += cellStart[c];
+                }
+                cellWidgets = (int *)malloc((cellStart[MENU_CELLS] + 1) * sizeof(int));
+            }
+        }
+        // The fill left every cellStart[c] at the start of cell c + 1
+        memmove(cellStart + 1, cellStart, MENU_CELLS * sizeof(int));
+        cellStart[0] = 0;
+    }
+
+    int hitTest(float x, float y)
+    {
+        int cell = clampCell(y, MENU_ROWS) * MENU_COLUMNS + clampCell(x, MENU_COLUMNS);
+        for (int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+        {
+            if (contains(widgets[cellWidgets[i]].bounds, x, y))
+            {
+                return cellWidgets[i];
+            }
+        }
+        return -1;
+    }
+
+    void markDirty(int id)
+    {
+        if (id < 0)
+        {
+            return;
+        }
+        Rectangle bounds = widgets[id].bounds;
+        if (!isDirty)
+        {
+            dirty = bounds;
+            isDirty = true;
+            return;
+        }
+        float right = fmaxf(dirty.x + dirty.width, bounds.x + bounds.width);
+        float bottom = fmaxf(dirty.y + dirty.height, bounds.y + bounds.height);
+        dirty.x = fminf(dirty.x, bounds.x);
+        dirty.y = fminf(dirty.y, bounds.y);
+        dirty.width = right - dirty.x;
+        dirty.height = bottom - dirty.y;
+    }
+
+    void setFocus(int id)
+    {
+        if (id != focus)
+        {
+            markDirty(focus);
+            markDirty(id);
+            focus = id;
+        }
+    }
+
+    // Selects an Option or presses a Button; returns the Button's value.
+    int activate(int id)
+    {
+        if (id < 0)
+        {
+            return -1;
+        }
+        Widget *widget = &widgets[id];
+        if (widget->spec.kind == WidgetKind::Button)
+        {
+            return widget->spec.value;
+        }
+        int group = widget->spec.group;
+        if (selected[group] != id)
+        {
+            markDirty(selected[group]);
+            markDirty(id);
+            selected[group] = id;
+        }
+        return -1;
+    }
+
+    void drawWidget(const Widget *widget, int id)
+    {
+        const WidgetSpec *spec = &widget->spec;
+        Color border = id == focus ? style.focus : style.normal;
+        switch (spec->kind)
+        {
+        case WidgetKind::Heading:
+        case WidgetKind::Label:
+            textRenderer.draw(spec->title, spec->x - widget->titleWidth / 2, spec->y, MENU_FONT,
+                              spec->kind == WidgetKind::Heading ? style.heading : style.label);
+            break;
+        case WidgetKind::Option:
+            DrawRectangleRec(Rectangle{(float)spec->x - 15, (float)spec->y, 30, 30},
+                             selected[spec->group] == id ? style.checked : style.unchecked);
+            DrawRectangleLines(spec->x - 15, spec->y, 30, 30, border);
+            textRenderer.draw(spec->title, spec->x + 35, spec->y + 5, MENU_FONT, style.text);
+            break;
+        case WidgetKind::Button:
+            DrawRectangleRec(widget->bounds, style.button);
+            DrawRectangleLines(spec->x - 50, spec->y, 100, 30, border);
+            textRenderer.draw(spec->title, spec->x - widget->titleWidth / 2, spec->y + 5, MENU_FONT, style.text);
+            break;
+        }
+    }
+
+    // Only the widgets inside area; the caller clips to it. No title
+    // overlaps another widget, so the titles can all go on top at the end.
+    void paint(Rectangle area)
+    {
+        DrawRectangleRec(area, style.background);
+        for (int i = 0; i < count; i++)
+        {
+            if (overlaps(widgets[i].bounds, area))
+            {
+                drawWidget(&widgets[i], i);
+            }
+        }
+        textRenderer.flush();
+    }
+
+public:
+    // Needs the window, for measuring titles. At most MENU_WIDGETS widgets
+    // and MENU_GROUPS groups; the rest are left out.
+    Menu(const WidgetSpec *table, int tableCount, const MenuStyle *menuStyle)
+        : count(0), focus(-1), style(*menuStyle), cellWidgets(NULL), isDirty(false)
+    {
+        for (int g = 0; g < MENU_GROUPS; g++)
+        {
+            selected[g] = -1;
+        }
+        for (int i = 0; i < tableCount && count < MENU_WIDGETS; i++)
+        {
+            const WidgetSpec *spec = &table[i];
+            if (spec->kind == WidgetKind::Option && (spec->group < 0 || spec->group >= MENU_GROUPS))
+            {
+                continue;
+            }
+            Widget *widget = &widgets[count];
+            widget->spec = *spec;
+            widget->titleWidth = textRenderer.measure(spec->title, MENU_FONT);
+            widget->bounds = widgetBounds(spec, widget->titleWidth);
+            if (spec->kind == WidgetKind::Option && selected[spec->group] < 0)
+            {
+                selected[spec->group] = count;
+            }
+            if (focus < 0 && interactive(widget))
+            {
+                focus = count;
+            }
+            count++;
+        }
+        dirty = Rectangle{0, 0, 0, 0};
+        buildIndex();
+    }
+
+    Menu(const Menu &) = delete;
+    Menu &operator=(const Menu &) = delete;
+
+    ~Menu()
+    {
+        free(cellWidgets);
+    }
+
+    // Returns the value of the Button the event pressed, or -1.
+    int dispatch(const MenuEvent *event)
+    {
+        switch (event->type)
+        {
+        case MenuEventType::Click:
+        {
+            int id = hitTest(event->x, event->y);
+            if (id < 0)
+            {
+                return -1;
+            }
+            setFocus(id);
+            return activate(id);
+        }
+        case MenuEventType::Next:
+            for (int step = 1; step <= count; step++)
+            {
+                int id = (focus + step) % count;
+                if (interactive(&widgets[id]))
+                {
+                    setFocus(id);
+                    break;
+                }
+            }
+            return -1;
+        case MenuEventType::Activate:
+            return activate(focus);
+        }
+        return -1;
+    }
+
+    // The value of the group's selected Option, or fallback when it has none.
+    int getValue(int group, int fallback)
+    {
+        if (group < 0 || group >= MENU_GROUPS || selected[group] < 0)
+        {
+            return fallback;
+        }
+        return widgets[selected[group]].spec.value;
+    }
+
+    // Whether update() has anything to repaint.
+    bool needsUpdate()
+    {
+        return isDirty;
+    }
+
+    // Repaints what changed into the canvas; call it outside BeginDrawing().
+    void update()
+    {
+        Color colors[9] = {style.background, style.heading, style.label, style.text, style.focus,
+                           style.normal, style.unchecked, style.checked, style.button};
+        int screenWidth = GetScreenWidth();
+        int screenHeight = GetScreenHeight();
+        if (canvas.begin(screenWidth, screenHeight, paletteKey(colors, 9)))
+        {
+            paint(Rectangle{0, 0, (float)screenWidth, (float)screenHeight});
+            canvas.end();
+        }
+        else if (isDirty)
+        {
+            canvas.patch();
+            BeginScissorMode((int)dirty.x, (int)dirty.y, (int)dirty.width + 1, (int)dirty.height + 1);
+            paint(dirty);
+            EndScissorMode();
+            canvas.end();
+        }
+        isDirty = false;
+    }
+
+    void draw()
+    {
+        canvas.draw();
+    }
+};
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "profiler.h"
+#include "random.h"
+
+// Datagrams for netplay. A UdpSocket is a non-blocking IPv4 socket with a
+// network simulator on its sending side: every datagram can be dropped
+// with a given probability, or held back for a latency plus a random
+// jitter before it really goes out. Held datagrams wait in a fixed queue
+// until pump() sends the ones that are due, so jitter can reorder them the
+// way a real network does. With the default NetConditions nothing is held
+// and send() goes straight to sendto(). Byte counts include the datagrams
+// the simulator drops, the way a sender would count them.
+// NetWriter and NetReader pack little-endian integers and floats into a
+// datagram and fail softly: an overrun is remembered and checked once at
+// the end instead of after every field.
+
+#define NET_PACKET 512
+#define NET_SHIM_QUEUE 256
+
+//STRUCTURS
+// Applied to everything one socket sends; latency and jitter in milliseconds.
+typedef struct NetConditions
+{
+    int latency;
+    int jitter;
+    float loss;
+} NetConditions;
+
+typedef struct NetCounters
+{
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint64_t packetsSent;
+    uint64_t packetsReceived;
+    uint64_t packetsDropped;
+} NetCounters;
+
+// "host:port", "host" or ":port"; whatever is left out keeps its default.
+inline bool parseAddress(const char *text, const char *defaultHost, int defaultPort, sockaddr_in *out)
+{
+    char host[256];
+    int port = defaultPort;
+    const char *colon = strrchr(text, ':');
+    size_t length = colon ? (size_t)(colon - text) : strlen(text);
+    if (length >= sizeof(host))
+    {
+        return false;
+    }
+    memcpy(host, text, length);
+    host[length] = '\0';
+    if (colon)
+    {
+        port = atoi(colon + 1);
+    }
+    if (length == 0)
+    {
+        strcpy(host, defaultHost);
+    }
+    if (port <= 0 || port > 65535)
+    {
+        return false;
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *result = NULL;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || !result)
+    {
+        return false;
+    }
+    memcpy(out, result->ai_addr, sizeof(*out));
+    out->sin_port = htons((uint16_t)port);
+    freeaddrinfo(result);
+    return true;
+}
+
+inline bool sameAddress(const sockaddr_in *a, const sockaddr_in *b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+//NET WRITER CLASS
+class NetWriter
+{
+private:
+    unsigned char *data;
+    int capacity;
+    int size;
+    bool overflow;
+
+public:
+    NetWriter(unsigned char *buffer, int bufferSize) : data(buffer), capacity(bufferSize), size(0), overflow(false) {}
+
+    void u8(unsigned value)
+    {
+        if (size + 1 > capacity)
+        {
+            overflow = true;
+            return;
+        }
+        data[size++] = (unsigned char)value;
+    }
+
+    void u16(unsigned value)
+    {
+        u8(value & 0xFF);
+        u8((value >> 8) & 0xFF);
+    }
+
+    void u32(uint32_t value)
+    {
+        u16(value & 0xFFFF);
+        u16(value >> 16);
+    }
+
+    void f32(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        u32(bits);
+    }
+
+    void bytes(const void *source, int count)
+    {
+        if (size + count > capacity)
+        {
+            overflow = true;
+            return;
+        }
+        memcpy(data + size, source, count);
+        size += count;
+    }
+
+    // 0 after an overrun, so nothing half written is ever sent.
+    int getSize()
+    {
+        return overflow ? 0 : size;
+    }
+};
+
+//NET READER CLASS
+class NetReader
+{
+private:
+    const unsigned char *data;
+    int size;
+    int offset;
+    bool overrun;
+
+public:
+    NetReader(const unsigned char *buffer, int bufferSize) : data(buffer), size(bufferSize), offset(0), overrun(false) {}
+
+    unsigned u8()
+    {
+        if (offset + 1 > size)
+        {
+            overrun = true;
+            return 0;
+        }
+        return data[offset++];
+    }
+
+    unsigned u16()
+    {
+        unsigned low = u8();
+        return low | (u8() << 8);
+    }
+
+    uint32_t u32()
+    {
+        uint32_t low = u16();
+        return low | ((uint32_t)u16() << 16);
+    }
+
+    float f32()
+    {
+        uint32_t bits = u32();
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void bytes(void *target, int count)
+    {
+        if (offset + count > size)
+        {
+            overrun = true;
+            memset(target, 0, count);
+            return;
+        }
+        memcpy(target, data + offset, count);
+        offset += count;
+    }
+
+    // False once anything was read past the end.
+    bool ok()
+    {
+        return !overrun;
+    }
+};
+
+//UDP SOCKET CLASS
+class UdpSocket
+{
+private:
+    typedef struct Delayed
+    {
+        uint64_t due;
+        sockaddr_in to;
+        int size;
+        unsigned char data[NET_PACKET];
+    } Delayed;
+
+    int descriptor;
+    NetConditions conditions;
+    Random random;
+    Delayed queue[NET_SHIM_QUEUE];
+    int queued;
+    NetCounters counters;
+
+    void transmit(const void *data, int size, const sockaddr_in *to)
+    {
+        sendto(descriptor, data, size, 0, (const sockaddr *)to, sizeof(*to));
+    }
+
+public:
+    UdpSocket() : descriptor(-1), conditions{0, 0, 0}, queued(0)
+    {
+        memset(&counters, 0, sizeof(counters));
+    }
+
+    UdpSocket(const UdpSocket &) = delete;
+    UdpSocket &operator=(const UdpSocket &) = delete;
+
+    ~UdpSocket()
+    {
+        close();
+    }
+
+    // Binds every interface on port, or a free port for 0.
+    bool open(int port)
+    {
+        close();
+        descriptor = socket(AF_INET, SOCK_DGRAM, 0);
+        if (descriptor < 0)
+        {
+            return false;
+        }
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons((uint16_t)port);
+        if (bind(descriptor, (const sockaddr *)&address, sizeof(address)) != 0 ||
+            fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK) != 0)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Sends whatever the simulator still holds first, then closes.
+    void close()
+    {
+        if (descriptor < 0)
+        {
+            return;
+        }
+        for (int i = 0; i < queued; i++)
+        {
+            transmit(queue[i].data, queue[i].size, &queue[i].to);
+        }
+        queued = 0;
+        ::close(descriptor);
+        descriptor = -1;
+    }
+
+    // seed makes the drops and the jitter reproducible.
+    void simulate(NetConditions newConditions, uint64_t seed)
+    {
+        conditions = newConditions;
+        random.setSeed(seed);
+    }
+
+    void send(const void *data, int size, const sockaddr_in *to)
+    {
+        if (descriptor < 0 || size <= 0 || size > NET_PACKET)
+        {
+            return;
+        }
+        counters.bytesSent += size;
+        counters.packetsSent++;
+        if (conditions.loss > 0 && random.uniform(0, 1) < conditions.loss)
+        {
+            counters.packetsDropped++;
+            return;
+        }
+        if (conditions.latency <= 0 && conditions.jitter <= 0)
+        {
+            transmit(data, size, to);
+            return;
+        }
+        if (queued == NET_SHIM_QUEUE)
+        {
+            counters.packetsDropped++;
+            return;
+        }
+        int delay = conditions.latency + (conditions.jitter > 0 ? random.value(-conditions.jitter, conditions.jitter) : 0);
+        Delayed *delayed = &queue[queued++];
+        delayed->due = nanoseconds() + (uint64_t)(delay > 0 ? delay : 0) * 1000000;
+        delayed->to = *to;
+        delayed->size = size;
+        memcpy(delayed->data, data, size);
+    }
+
+    // Sends the held datagrams that are due.
+    void pump()
+    {
+        uint64_t now = nanoseconds();
+        for (int i = 0; i < queued;)
+        {
+            if (queue[i].due <= now)
+            {
+                transmit(queue[i].data, queue[i].size, &queue[i].to);
+                queue[i] = queue[--queued];
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    // The next datagram's size, or -1 when there is none.
+    int receive(void *buffer, int size, sockaddr_in *from)
+    {
+        if (descriptor < 0)
+        {
+            return -1;
+        }
+        socklen_t length = sizeof(*from);
+        int received = (int)recvfrom(descriptor, buffer, size, 0, (sockaddr *)from, &length);
+        if (received < 0)
+        {
+            return -1;
+        }
+        counters.bytesReceived += received;
+        counters.packetsReceived++;
+        return received;
+    }
+
+    // Blocks until a datagram arrives, a held one is due or seconds pass.
+    void wait(double seconds)
+    {
+        uint64_t now = nanoseconds();
+        uint64_t until = now + (uint64_t)(seconds > 0 ? seconds * 1e9 : 0);
+        for (int i = 0; i < queued; i++)
+        {
+            until = queue[i].due < until ? queue[i].due : until;
+        }
+        if (descriptor < 0 || until <= now)
+        {
+            return;
+        }
+        pollfd request = {descriptor, POLLIN, 0};
+        poll(&request, 1, (int)((until - now + 999999) / 1000000));
+    }
+
+    NetCounters getCounters()
+    {
+        return counters;
+    }
+};
+
+#endif
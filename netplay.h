@@ -0,0 +1,1281 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "net.h"
+#include "pipeline.h"
+#include "replay.h"
+#include "simulation.h"
+#include "telemetry.h"
+
+// Two players on two machines. A NetServer runs the only Simulation, on a
+// thread of its own, and nothing a client says changes it except the two
+// buttons of that client's paddle. Every tick it merges both players'
+// buttons into one Input bitmask, steps, and sends each client a snapshot
+// of the ball, both paddles and the scores. The left paddle belongs to the
+// first client to say hello, the right paddle to the second. The match
+// starts once both are there and ends when either says goodbye or goes
+// quiet for NET_TIMEOUT. A snapshot is a delta against the newest
+// snapshot the client has acknowledged: only the fields that differ from it
+// go out, behind a byte saying which ones those are, and a client that has
+// acknowledged nothing gets everything. Ball positions are 1/32 pixel, its
+// angle 1/65536 of a turn; paddles are sent as they are, so prediction can
+// be checked to the bit.
+//
+// A NetClient runs a tick clock of its own and stamps the buttons sampled
+// on tick c for tick c + inputDelay. Every input message repeats all the
+// stamps the server has not acknowledged, up to NET_REDUNDANCY of them, so
+// a lost datagram costs nothing as long as a later one gets through. The
+// server reports in every snapshot how many ticks early the newest stamp
+// arrived (its slack); the client runs a tick more or less until the slack
+// sits at NET_MARGIN, and jumps its clock when it is off by more than
+// NET_RESYNC. A stamp that arrives after its tick was stepped is late: the
+// server stepped that tick with the player's previous buttons instead.
+//
+// The local paddle is predicted: on every tick the client puts it where the
+// newest snapshot had it and runs the stamps after that snapshot's tick
+// through its own copy of the paddle, at most rollback of them. A snapshot
+// that disagrees with what was predicted for its tick counts as a
+// correction. The ball and the other paddle are drawn between the two
+// newest snapshots. A bigger input delay hides more latency at the cost of
+// a slower paddle; with enough of it nothing has to be predicted at all.
+//
+// Both sides keep per tick averages of bytes sent and received, and the
+// client the round trip from sending a stamp to the first snapshot that
+// acknowledges it, and report them to telemetry once per second of ticks.
+//
+//     hello    C->S  magic version 1
+//     welcome  S->C  magic version 2 player path difficulty program tickRate:u16 interval:u16 tick:u32
+//     input    C->S  magic version 3 ack:u32 newest:u32 count:u8 buttons (2 bits each, newest first)
+//     snapshot S->C  magic version 4 tick:u32 base:u32 stamp:u32 slack:i8 fields:u8 [fields]
+//     bye      both  magic version 5
+
+#define NET_PORT 7777
+#define NET_TICK_RATE FPS
+#define NET_MAGIC 0x50
+#define NET_VERSION 1
+#define NET_HISTORY 256
+#define NET_REDUNDANCY 64
+#define NET_MARGIN 2
+#define NET_BAND 2
+#define NET_RESYNC 8
+#define NET_DELAY 0
+#define NET_ROLLBACK 32
+#define NET_TIMEOUT 5.0
+#define NET_HELLO 0.25
+#define NET_POSITION 32.0f
+#define NET_NONE 0xFFFFFFFFu
+
+//STRUCTURS
+enum NetMessage
+{
+    NetHello = 1,
+    NetWelcome,
+    NetInput,
+    NetSnapshot,
+    NetBye
+};
+
+enum NetField
+{
+    FieldBall = 1,
+    FieldLeft = 2,
+    FieldRight = 4,
+    FieldScore = 8
+};
+
+// One player's buttons, whichever paddle is theirs.
+enum NetButton
+{
+    ButtonUp = 1,
+    ButtonDown = 2
+};
+
+// What a client can tune; conditions are simulated on everything it sends.
+typedef struct NetTuning
+{
+    int inputDelay;
+    int rollback;
+    NetConditions conditions;
+} NetTuning;
+
+// One tick as it goes over the wire.
+typedef struct NetState
+{
+    uint32_t tick;
+    uint16_t ballX;
+    uint16_t ballY;
+    uint16_t ballAngle;
+    float leftY;
+    float rightY;
+    uint8_t leftScore;
+    uint8_t rightScore;
+} NetState;
+
+// How a peer's link did over a window of ticks. Bytes are UDP payload per
+// tick; the round trip is from sending an input to the first snapshot that
+// acknowledges it.
+typedef struct NetReport
+{
+    uint64_t tick;
+    uint64_t ticks;
+    double sentPerTick;
+    double receivedPerTick;
+    uint64_t packetsSent;
+    uint64_t packetsReceived;
+    uint64_t packetsDropped;
+    uint64_t fullSnapshots;
+    uint64_t deltaSnapshots;
+    uint64_t missedInputs;
+    uint64_t lateInputs;
+    uint64_t corrections;
+    float maxCorrection;
+    int predicted;
+    int slack;
+    uint64_t roundTripP50;
+    uint64_t roundTripP99;
+    uint64_t roundTripMax;
+} NetReport;
+
+//TELEMETRY
+// Safe from the server thread, too: one fprintf takes the stream's lock,
+// which writeFrame() holds per line.
+inline void Telemetry::net(const char *role, const NetReport *report)
+{
+    if (!file)
+    {
+        return;
+    }
+    fprintf(file,
+            "{\"type\": \"net\", \"session\": %llu, \"role\": \"%s\", \"tick\": %llu, \"ticks\": %llu, "
+            "\"sent_bytes_per_tick\": %.1f, \"received_bytes_per_tick\": %.1f, \"packets_sent\": %llu, "
+            "\"packets_received\": %llu, \"packets_dropped\": %llu, \"full_snapshots\": %llu, "
+            "\"delta_snapshots\": %llu, \"missed_inputs\": %llu, \"late_inputs\": %llu, \"corrections\": %llu, "
+            "\"max_correction_px\": %.3f, \"predicted_ticks\": %d, \"input_slack\": %d, \"rtt_p50_ns\": %llu, "
+            "\"rtt_p99_ns\": %llu, \"rtt_max_ns\": %llu}\n",
+            session.id, role, (unsigned long long)report->tick, (unsigned long long)report->ticks,
+            report->sentPerTick, report->receivedPerTick, (unsigned long long)report->packetsSent,
+            (unsigned long long)report->packetsReceived, (unsigned long long)report->packetsDropped,
+            (unsigned long long)report->fullSnapshots, (unsigned long long)report->deltaSnapshots,
+            (unsigned long long)report->missedInputs, (unsigned long long)report->lateInputs,
+            (unsigned long long)report->corrections, report->maxCorrection, report->predicted, report->slack,
+            (unsigned long long)report->roundTripP50, (unsigned long long)report->roundTripP99,
+            (unsigned long long)report->roundTripMax);
+}
+
+//PROTOCOL
+inline unsigned quantize(float value, float scale)
+{
+    float scaled = value * scale + 0.5f;
+    return scaled <= 0 ? 0 : scaled >= 65535 ? 65535 : (unsigned)scaled;
+}
+
+inline NetState captureState(Simulation *simulation, Player *player1, Player *player2)
+{
+    Ball *ball = simulation->getBall();
+    float angle = fmodf(ball->rotationAngle(1), 2 * PI);
+    NetState state;
+    state.tick = (uint32_t)simulation->getTick();
+    state.ballX = (uint16_t)quantize(ball->getX(), NET_POSITION);
+    state.ballY = (uint16_t)quantize(ball->getY(), NET_POSITION);
+    state.ballAngle = (uint16_t)((unsigned)((angle < 0 ? angle + 2 * PI : angle) * (65536 / (2 * PI))) & 0xFFFF);
+    state.leftY = simulation->getLeftPaddle()->getY();
+    state.rightY = simulation->getRightPaddle()->getY();
+    state.leftScore = (uint8_t)player1->getScore();
+    state.rightScore = (uint8_t)player2->getScore();
+    return state;
+}
+
+// Everything in state that differs from base, or all of it without one.
+inline void writeState(NetWriter *writer, const NetState *state, const NetState *base)
+{
+    unsigned fields = 0;
+    if (!base || state->ballX != base->ballX || state->ballY != base->ballY || state->ballAngle != base->ballAngle)
+    {
+        fields |= FieldBall;
+    }
+    if (!base || memcmp(&state->leftY, &base->leftY, sizeof(float)))
+    {
+        fields |= FieldLeft;
+    }
+    if (!base || memcmp(&state->rightY, &base->rightY, sizeof(float)))
+    {
+        fields |= FieldRight;
+    }
+    if (!base || state->leftScore != base->leftScore || state->rightScore != base->rightScore)
+    {
+        fields |= FieldScore;
+    }
+
+    writer->u8(fields);
+    if (fields & FieldBall)
+    {
+        writer->u16(state->ballX);
+        writer->u16(state->ballY);
+        writer->u16(state->ballAngle);
+    }
+    if (fields & FieldLeft)
+    {
+        writer->f32(state->leftY);
+    }
+    if (fields & FieldRight)
+    {
+        writer->f32(state->rightY);
+    }
+    if (fields & FieldScore)
+    {
+        writer->u8(state->leftScore);
+        writer->u8(state->rightScore);
+    }
+}
+
+// Fields writeState() left out are taken from base, which must be the same
+// one the writer used.
+inline bool readState(NetReader *reader, const NetState *base, uint32_t tick, NetState *state)
+{
+    unsigned fields = reader->u8();
+    unsigned everything = FieldBall | FieldLeft | FieldRight | FieldScore;
+    if (!base && fields != everything)
+    {
+        return false;
+    }
+    if (base)
+    {
+        *state = *base;
+    }
+    state->tick = tick;
+    if (fields & FieldBall)
+    {
+        state->ballX = (uint16_t)reader->u16();
+        state->ballY = (uint16_t)reader->u16();
+        state->ballAngle = (uint16_t)reader->u16();
+    }
+    if (fields & FieldLeft)
+    {
+        state->leftY = reader->f32();
+    }
+    if (fields & FieldRight)
+    {
+        state->rightY = reader->f32();
+    }
+    if (fields & FieldScore)
+    {
+        state->leftScore = (uint8_t)reader->u8();
+        state->rightScore = (uint8_t)reader->u8();
+    }
+    return reader->ok();
+}
+
+inline void writeHeader(NetWriter *writer, NetMessage message)
+{
+    writer->u8(NET_MAGIC);
+    writer->u8(NET_VERSION);
+    writer->u8(message);
+}
+
+// The message type, or 0 for anything that is not ours.
+inline unsigned readHeader(NetReader *reader)
+{
+    unsigned magic = reader->u8();
+    unsigned version = reader->u8();
+    unsigned message = reader->u8();
+    return reader->ok() && magic == NET_MAGIC && version == NET_VERSION ? message : 0;
+}
+
+// Either paddle's keys on this keyboard move the player's own paddle.
+inline unsigned netButtons(unsigned input)
+{
+    return (input & (InputW | InputUp) ? ButtonUp : 0) | (input & (InputS | InputDown) ? ButtonDown : 0);
+}
+
+// The Input bits player's buttons stand for; player 0 is the left paddle.
+inline unsigned netInput(unsigned buttons, int player)
+{
+    if (player == 0)
+    {
+        return (buttons & ButtonUp ? InputW : 0) | (buttons & ButtonDown ? InputS : 0);
+    }
+    return (buttons & ButtonUp ? InputUp : 0) | (buttons & ButtonDown ? InputDown : 0);
+}
+
+//NET STATISTICS CLASS
+// Counts for the current report window and for the whole session.
+class NetStatistics
+{
+private:
+    NetReport window;
+    NetReport total;
+    NetCounters start;
+    Histogram roundTrip;
+    Histogram totalRoundTrip;
+    float maxCorrection;
+
+    static void finish(NetReport *report, const NetCounters *counters, const Histogram *histogram)
+    {
+        report->sentPerTick = report->ticks ? (double)counters->bytesSent / report->ticks : 0;
+        report->receivedPerTick = report->ticks ? (double)counters->bytesReceived / report->ticks : 0;
+        report->packetsSent = counters->packetsSent;
+        report->packetsReceived = counters->packetsReceived;
+        report->packetsDropped = counters->packetsDropped;
+        report->roundTripP50 = histogram->percentile(0.50);
+        report->roundTripP99 = histogram->percentile(0.99);
+        report->roundTripMax = histogram->getMax();
+    }
+
+public:
+    NetStatistics()
+    {
+        memset(&window, 0, sizeof(window));
+        memset(&total, 0, sizeof(total));
+        memset(&start, 0, sizeof(start));
+        maxCorrection = 0;
+    }
+
+    void tick()
+    {
+        window.ticks++;
+    }
+
+    void snapshot(bool full)
+    {
+        (full ? window.fullSnapshots : window.deltaSnapshots)++;
+    }
+
+    void missed()
+    {
+        window.missedInputs++;
+    }
+
+    void late()
+    {
+        window.lateInputs++;
+    }
+
+    void correction(float distance)
+    {
+        window.corrections++;
+        window.maxCorrection = distance > window.maxCorrection ? distance : window.maxCorrection;
+    }
+
+    void roundTripTime(uint64_t elapsed)
+    {
+        roundTrip.record(elapsed);
+    }
+
+    // Closes the window at tick; counters are the socket's so far.
+    NetReport take(uint64_t tick, NetCounters counters, int predicted, int slack)
+    {
+        NetCounters delta = {counters.bytesSent - start.bytesSent, counters.bytesReceived - start.bytesReceived,
+                             counters.packetsSent - start.packetsSent, counters.packetsReceived - start.packetsReceived,
+                             counters.packetsDropped - start.packetsDropped};
+        window.tick = tick;
+        window.predicted = predicted;
+        window.slack = slack;
+        finish(&window, &delta, &roundTrip);
+        NetReport report = window;
+
+        total.tick = tick;
+        total.ticks += window.ticks;
+        total.fullSnapshots += window.fullSnapshots;
+        total.deltaSnapshots += window.deltaSnapshots;
+        total.missedInputs += window.missedInputs;
+        total.lateInputs += window.lateInputs;
+        total.corrections += window.corrections;
+        total.maxCorrection = window.maxCorrection > total.maxCorrection ? window.maxCorrection : total.maxCorrection;
+        total.predicted = predicted;
+        total.slack = slack;
+        totalRoundTrip.merge(roundTrip);
+        finish(&total, &counters, &totalRoundTrip);
+
+        memset(&window, 0, sizeof(window));
+        roundTrip.reset();
+        start = counters;
+        return report;
+    }
+
+    // The session so far, as of the last take().
+    NetReport getTotal()
+    {
+        return total;
+    }
+};
+
+//NET SERVER CLASS
+class NetServer
+{
+private:
+    typedef struct Peer
+    {
+        bool connected;
+        sockaddr_in address;
+        uint64_t heard;
+        uint8_t buttons[NET_HISTORY];
+        uint32_t stamps[NET_HISTORY];
+        uint32_t guessed[NET_HISTORY];
+        uint32_t newest;
+        uint32_t ack;
+        bool acknowledged;
+        int slack;
+        unsigned last;
+    } Peer;
+
+    Simulation *simulation;
+    Player *player1;
+    Player *player2;
+    ReplayWriter *replay;
+    Telemetry *telemetry;
+    GameMode gameMode;
+    int tickRate;
+    int interval;
+    uint64_t tickTime;
+
+    UdpSocket socket;
+    Peer peers[2];
+    NetState history[NET_HISTORY];
+    NetStatistics statistics;
+    std::mutex totalMutex;
+    NetReport total;
+
+    long startedAt;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<bool> over;
+    std::atomic<int> players;
+
+    void send(NetWriter *writer, unsigned char *buffer, const sockaddr_in *to)
+    {
+        socket.send(buffer, writer->getSize(), to);
+    }
+
+    void bye(int player)
+    {
+        unsigned char buffer[NET_PACKET];
+        NetWriter writer(buffer, sizeof(buffer));
+        writeHeader(&writer, NetBye);
+        send(&writer, buffer, &peers[player].address);
+    }
+
+    // Before the first tick the seat is free again; after it the match is
+    // over and the other player is told so.
+    void drop(int player)
+    {
+        peers[player].connected = false;
+        players.fetch_sub(1);
+        if (simulation->getTick() > startedAt && peers[1 - player].connected)
+        {
+            bye(1 - player);
+            over.store(true);
+        }
+    }
+
+    void welcome(int player)
+    {
+        unsigned char buffer[NET_PACKET];
+        NetWriter writer(buffer, sizeof(buffer));
+        writeHeader(&writer, NetWelcome);
+        writer.u8(player);
+        writer.u8((unsigned)gameMode.path);
+        writer.u8((unsigned)gameMode.difficulty);
+        writer.u8((unsigned)gameMode.program);
+        writer.u16(tickRate);
+        writer.u16(interval);
+        writer.u32((uint32_t)simulation->getTick());
+        send(&writer, buffer, &peers[player].address);
+    }
+
+    void hello(const sockaddr_in *from, uint64_t now)
+    {
+        int player = -1;
+        for (int p = 0; p < 2 && player < 0; p++)
+        {
+            if (peers[p].connected && sameAddress(&peers[p].address, from))
+            {
+                player = p;
+            }
+        }
+        for (int p = 0; p < 2 && player < 0; p++)
+        {
+            if (!peers[p].connected)
+            {
+                player = p;
+                Peer *peer = &peers[p];
+                memset(peer, 0, sizeof(*peer));
+                memset(peer->stamps, 0xFF, sizeof(peer->stamps));
+                memset(peer->guessed, 0xFF, sizeof(peer->guessed));
+                peer->connected = true;
+                peer->address = *from;
+                peer->newest = (uint32_t)simulation->getTick();
+                players.fetch_add(1);
+            }
+        }
+        if (player >= 0)
+        {
+            peers[player].heard = now;
+            welcome(player);
+        }
+    }
+
+    void input(Peer *peer, NetReader *reader, uint64_t now)
+    {
+        uint32_t ack = reader->u32();
+        uint32_t newest = reader->u32();
+        int count = (int)reader->u8();
+        unsigned char packed[NET_REDUNDANCY / 4];
+        count = count < NET_REDUNDANCY ? count : NET_REDUNDANCY;
+        reader->bytes(packed, (count + 3) / 4);
+        if (!reader->ok())
+        {
+            return;
+        }
+        peer->heard = now;
+
+        uint32_t tick = (uint32_t)simulation->getTick();
+        if (ack <= tick && (!peer->acknowledged || (int32_t)(ack - peer->ack) > 0))
+        {
+            peer->ack = ack;
+            peer->acknowledged = true;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            uint32_t stamp = newest - i;
+            unsigned buttons = (packed[i / 4] >> (i % 4 * 2)) & 3;
+            int slot = stamp & (NET_HISTORY - 1);
+            if ((int32_t)(stamp - tick) > 0)
+            {
+                if ((int32_t)(stamp - tick) < NET_HISTORY)
+                {
+                    peer->buttons[slot] = (uint8_t)buttons;
+                    peer->stamps[slot] = stamp;
+                }
+            }
+            else if (peer->guessed[slot] == stamp)
+            {
+                peer->guessed[slot] = NET_NONE;
+                statistics.late();
+            }
+        }
+        // A reordered datagram carries an older newest; it must not pull
+        // the acknowledged stamp or the slack back
+        if ((int32_t)(newest - peer->newest) > 0)
+        {
+            peer->newest = newest;
+            peer->slack = (int)(int32_t)(newest - tick) - 1;
+        }
+    }
+
+    void receive(uint64_t now)
+    {
+        unsigned char buffer[NET_PACKET];
+        sockaddr_in from;
+        int size;
+        while ((size = socket.receive(buffer, sizeof(buffer), &from)) >= 0)
+        {
+            NetReader reader(buffer, size);
+            unsigned message = readHeader(&reader);
+            if (message == NetHello)
+            {
+                hello(&from, now);
+                continue;
+            }
+            for (int p = 0; p < 2; p++)
+            {
+                Peer *peer = &peers[p];
+                if (!peer->connected || !sameAddress(&peer->address, &from))
+                {
+                    continue;
+                }
+                if (message == NetInput)
+                {
+                    input(peer, &reader, now);
+                }
+                else if (message == NetBye)
+                {
+                    drop(p);
+                }
+            }
+        }
+    }
+
+    void sendSnapshot(Peer *peer, uint32_t tick)
+    {
+        const NetState *base = NULL;
+        if (peer->acknowledged && tick - peer->ack < NET_HISTORY && history[peer->ack & (NET_HISTORY - 1)].tick == peer->ack)
+        {
+            base = &history[peer->ack & (NET_HISTORY - 1)];
+        }
+        int slack = peer->slack < -128 ? -128 : peer->slack > 127 ? 127 : peer->slack;
+
+        unsigned char buffer[NET_PACKET];
+        NetWriter writer(buffer, sizeof(buffer));
+        writeHeader(&writer, NetSnapshot);
+        writer.u32(tick);
+        writer.u32(base ? base->tick : NET_NONE);
+        writer.u32(peer->newest);
+        writer.u8((unsigned)(slack & 0xFF));
+        writeState(&writer, &history[tick & (NET_HISTORY - 1)], base);
+        send(&writer, buffer, &peer->address);
+        statistics.snapshot(base == NULL);
+    }
+
+    // One tick with whatever both players' buttons for it are by now.
+    void step()
+    {
+        uint32_t tick = (uint32_t)simulation->getTick() + 1;
+        int slot = tick & (NET_HISTORY - 1);
+        unsigned input = 0;
+        for (int p = 0; p < 2; p++)
+        {
+            Peer *peer = &peers[p];
+            if (peer->stamps[slot] == tick)
+            {
+                peer->last = peer->buttons[slot];
+            }
+            else
+            {
+                peer->guessed[slot] = tick;
+                statistics.missed();
+            }
+            input |= netInput(peer->last, p);
+        }
+        if (replay)
+        {
+            replay->record(input, 1);
+        }
+        simulation->step(input);
+        history[slot] = captureState(simulation, player1, player2);
+        statistics.tick();
+
+        if (tick % interval == 0)
+        {
+            for (int p = 0; p < 2; p++)
+            {
+                sendSnapshot(&peers[p], tick);
+            }
+        }
+        if (tick % tickRate == 0)
+        {
+            int slack = peers[0].slack < peers[1].slack ? peers[0].slack : peers[1].slack;
+            NetReport report = statistics.take(tick, socket.getCounters(), 0, slack);
+            if (telemetry)
+            {
+                telemetry->net("server", &report);
+            }
+            std::lock_guard<std::mutex> lock(totalMutex);
+            total = statistics.getTotal();
+        }
+    }
+
+    // Ticks on the wall clock while both players are there. A player that
+    // goes quiet for NET_TIMEOUT is dropped. Before the first tick the seat
+    // is free for the next hello; after it, if the other player is still
+    // there, the match is over and they get a bye.
+    void run()
+    {
+        uint64_t start = 0;
+        uint64_t startTick = 0;
+        bool ticking = false;
+        while (running.load(std::memory_order_acquire))
+        {
+            uint64_t now = nanoseconds();
+            receive(now);
+            for (int p = 0; p < 2; p++)
+            {
+                if (peers[p].connected && now - peers[p].heard > (uint64_t)(NET_TIMEOUT * 1e9))
+                {
+                    drop(p);
+                }
+            }
+
+            bool ready = peers[0].connected && peers[1].connected && !over.load();
+            if (ready && !ticking)
+            {
+                start = now;
+                startTick = simulation->getTick();
+            }
+            ticking = ready;
+
+            double wait = 0.01;
+            if (ticking)
+            {
+                // Like Simulation::advance(), a stall costs at most MAX_FRAME_TIME of ticks
+                uint64_t due = startTick + (now - start) / tickTime;
+                if (due - simulation->getTick() > (uint64_t)(MAX_FRAME_TIME * 1e9) / tickTime)
+                {
+                    startTick = simulation->getTick();
+                    start = now;
+                    due = startTick;
+                }
+                while ((uint64_t)simulation->getTick() < due)
+                {
+                    step();
+                }
+                wait = (int64_t)(start + (simulation->getTick() + 1 - startTick) * tickTime - nanoseconds()) / 1e9;
+            }
+            socket.pump();
+            socket.wait(wait);
+        }
+
+        for (int p = 0; p < 2; p++)
+        {
+            if (peers[p].connected)
+            {
+                bye(p);
+            }
+        }
+        socket.close();
+    }
+
+public:
+    // The simulation is the server thread's from start() to stop(), and
+    // should be for two players without chaos balls. replay and telemetry
+    // may be NULL.
+    NetServer(Simulation *s, Player *p1, Player *p2, GameMode *gM, int rate, ReplayWriter *r, Telemetry *t)
+        : simulation(s), player1(p1), player2(p2), replay(r), telemetry(t), gameMode(*gM), tickRate(rate),
+          interval(rate > FPS ? rate / FPS : 1), tickTime(1000000000ull / rate), startedAt(s->getTick()), running(false),
+          over(false), players(0)
+    {
+        memset(peers, 0, sizeof(peers));
+        memset(history, 0xFF, sizeof(history));
+        memset(&total, 0, sizeof(total));
+    }
+
+    NetServer(const NetServer &) = delete;
+    NetServer &operator=(const NetServer &) = delete;
+
+    ~NetServer()
+    {
+        stop();
+    }
+
+    bool open(int port, NetConditions conditions, uint64_t seed)
+    {
+        socket.simulate(conditions, seed);
+        return socket.open(port);
+    }
+
+    void start()
+    {
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&NetServer::run, this);
+    }
+
+    // Says goodbye to both players; after stop() the simulation is the caller's again.
+    void stop()
+    {
+        if (thread.joinable())
+        {
+            running.store(false, std::memory_order_release);
+            thread.join();
+        }
+    }
+
+    int getPlayers()
+    {
+        return players.load();
+    }
+
+    // Whether a player left after the match started.
+    bool isOver()
+    {
+        return over.load();
+    }
+
+    // As of the last full second of ticks.
+    NetReport getTotal()
+    {
+        std::lock_guard<std::mutex> lock(totalMutex);
+        return total;
+    }
+};
+
+//NET CLIENT CLASS
+class NetClient
+{
+private:
+    UdpSocket socket;
+    sockaddr_in server;
+    NetTuning tuning;
+    Telemetry *telemetry;
+    int player;
+    GameMode gameMode;
+    int tickRate;
+    int interval;
+    float dt;
+    bool playing;
+    bool ended;
+    uint64_t helloAt;
+    uint64_t heard;
+
+    NetState states[NET_HISTORY];
+    NetState previous;
+    NetState latest;
+    uint64_t latestAt;
+
+    uint8_t buttons[NET_HISTORY];
+    uint32_t stamps[NET_HISTORY];
+    uint64_t sentAt[NET_HISTORY];
+    float predicted[NET_HISTORY];
+    uint32_t predictedTicks[NET_HISTORY];
+    long clientTick;
+    long newestStamp;
+    uint32_t stampAck;
+    long adjustAfter;
+    int slack;
+    bool slackFresh;
+    uint64_t lastUpdate;
+    double accumulator;
+
+    LeftPaddle left;
+    RightPaddle right;
+    float localY;
+    float localPreviousY;
+    bool predicting;
+    NetStatistics statistics;
+
+    Paddle *local()
+    {
+        return player == 0 ? (Paddle *)&left : (Paddle *)&right;
+    }
+
+    float serverY(const NetState *state)
+    {
+        return player == 0 ? state->leftY : state->rightY;
+    }
+
+    // Puts the local paddle where the newest snapshot had it and plays the
+    // stamps after it forward to the client's tick, at most rollback of them.
+    void predict()
+    {
+        float y = serverY(&latest);
+        long from = latest.tick;
+        long to = clientTick < from + tuning.rollback ? clientTick : from + tuning.rollback;
+        localPreviousY = y;
+        local()->place(y);
+        for (long t = from + 1; t <= to; t++)
+        {
+            int slot = t & (NET_HISTORY - 1);
+            unsigned input = netInput(stamps[slot] == (uint32_t)t ? buttons[slot] : 0, player);
+            localPreviousY = local()->getY();
+            if (player == 0)
+            {
+                left.update(input, dt);
+            }
+            else
+            {
+                right.update(NULL, input, dt);
+            }
+            predicted[slot] = local()->getY();
+            predictedTicks[slot] = (uint32_t)t;
+        }
+        localY = local()->getY();
+        predicting = to > from;
+    }
+
+    void tick(unsigned tickButtons, uint64_t now)
+    {
+        clientTick++;
+        long stamp = clientTick + tuning.inputDelay;
+        for (long s = newestStamp < stamp ? newestStamp + 1 : stamp; s <= stamp; s++)
+        {
+            int slot = s & (NET_HISTORY - 1);
+            buttons[slot] = (uint8_t)tickButtons;
+            stamps[slot] = (uint32_t)s;
+            sentAt[slot] = now;
+        }
+        newestStamp = stamp;
+        predict();
+        statistics.tick();
+        if (clientTick % tickRate == 0)
+        {
+            NetReport report = statistics.take(clientTick, socket.getCounters(), (int)(clientTick - latest.tick), slack);
+            if (telemetry)
+            {
+                telemetry->net(player == 0 ? "left" : "right", &report);
+            }
+        }
+    }
+
+    void sendInput()
+    {
+        long unacknowledged = newestStamp - (long)stampAck;
+        int count = unacknowledged < 1 ? 1 : unacknowledged > NET_REDUNDANCY ? NET_REDUNDANCY : (int)unacknowledged;
+        unsigned char packed[NET_REDUNDANCY / 4];
+        memset(packed, 0, sizeof(packed));
+        for (int i = 0; i < count; i++)
+        {
+            long stamp = newestStamp - i;
+            int slot = stamp & (NET_HISTORY - 1);
+            unsigned value = stamps[slot] == (uint32_t)stamp ? buttons[slot] : 0;
+            packed[i / 4] |= (unsigned char)(value << (i % 4 * 2));
+        }
+
+        unsigned char buffer[NET_PACKET];
+        NetWriter writer(buffer, sizeof(buffer));
+        writeHeader(&writer, NetInput);
+        writer.u32(latest.tick);
+        writer.u32((uint32_t)newestStamp);
+        writer.u8(count);
+        for (int i = 0; i < (count + 3) / 4; i++)
+        {
+            writer.u8(packed[i]);
+        }
+        socket.send(buffer, writer.getSize(), &server);
+    }
+
+    void welcome(NetReader *reader)
+    {
+        int newPlayer = (int)reader->u8();
+        GameMode mode = {2, (Path)reader->u8(), (Difficulty)reader->u8(), (Program)reader->u8()};
+        int rate = (int)reader->u16();
+        int snapshotInterval = (int)reader->u16();
+        reader->u32();
+        if (!reader->ok() || player >= 0 || newPlayer > 1 || rate <= 0 || snapshotInterval <= 0)
+        {
+            return;
+        }
+        player = newPlayer;
+        gameMode = mode;
+        tickRate = rate;
+        interval = snapshotInterval;
+        dt = 1.0f / rate;
+        right = RightPaddle(SCREEN_WIDTH, SCREEN_HEIGHT / 2, false, mode.difficulty, NULL);
+    }
+
+    void snapshot(NetReader *reader, uint64_t now)
+    {
+        uint32_t tick = reader->u32();
+        uint32_t base = reader->u32();
+        uint32_t stamp = reader->u32();
+        int stampSlack = (int)(int8_t)reader->u8();
+        const NetState *baseState = NULL;
+        if (base != NET_NONE)
+        {
+            baseState = &states[base & (NET_HISTORY - 1)];
+            if (baseState->tick != base)
+            {
+                return;
+            }
+        }
+        NetState state;
+        if (!reader->ok() || !readState(reader, baseState, tick, &state))
+        {
+            return;
+        }
+        states[tick & (NET_HISTORY - 1)] = state;
+        statistics.snapshot(baseState == NULL);
+
+        if (!playing || (int32_t)(tick - latest.tick) > 0)
+        {
+            previous = playing ? latest : state;
+            latest = state;
+            latestAt = now;
+        }
+        int slot = tick & (NET_HISTORY - 1);
+        if (predictedTicks[slot] == tick && memcmp(&predicted[slot], player == 0 ? &state.leftY : &state.rightY, sizeof(float)))
+        {
+            statistics.correction(fabsf(predicted[slot] - serverY(&state)));
+        }
+        predictedTicks[slot] = NET_NONE;
+
+        if (!playing)
+        {
+            playing = true;
+            clientTick = (long)tick + NET_MARGIN - tuning.inputDelay;
+            newestStamp = clientTick + tuning.inputDelay;
+            stampAck = stamp;
+            adjustAfter = newestStamp + 1;
+            lastUpdate = now;
+            accumulator = 0;
+        }
+        if ((int32_t)(stamp - stampAck) > 0)
+        {
+            int stampSlot = stamp & (NET_HISTORY - 1);
+            if (stamps[stampSlot] == stamp)
+            {
+                statistics.roundTripTime(now - sentAt[stampSlot]);
+            }
+            stampAck = stamp;
+        }
+        // Only a stamp sent since the clock last moved says where it is now
+        if ((long)stamp >= adjustAfter)
+        {
+            slack = stampSlack;
+            slackFresh = true;
+        }
+        predict();
+    }
+
+    void receive(uint64_t now)
+    {
+        unsigned char buffer[NET_PACKET];
+        sockaddr_in from;
+        int size;
+        while ((size = socket.receive(buffer, sizeof(buffer), &from)) >= 0)
+        {
+            if (!sameAddress(&from, &server))
+            {
+                continue;
+            }
+            NetReader reader(buffer, size);
+            unsigned message = readHeader(&reader);
+            if (message)
+            {
+                heard = now;
+            }
+            if (message == NetWelcome)
+            {
+                welcome(&reader);
+            }
+            else if (message == NetSnapshot && player >= 0)
+            {
+                snapshot(&reader, now);
+            }
+            else if (message == NetBye)
+            {
+                ended = true;
+            }
+        }
+    }
+
+    // How many ticks to run now: the ones the wall clock says are due, one
+    // more or one less while the server says stamps arrive too late or too
+    // early, and a jump when they are far off.
+    int dueTicks(uint64_t now)
+    {
+        float elapsed = (now - lastUpdate) / 1e9f;
+        lastUpdate = now;
+        accumulator += elapsed < MAX_FRAME_TIME ? elapsed : MAX_FRAME_TIME;
+        int due = (int)(accumulator / dt);
+        accumulator -= due * dt;
+
+        if (!slackFresh)
+        {
+            return due;
+        }
+        int error = slack - NET_MARGIN;
+        if (error < -NET_RESYNC || error > NET_RESYNC)
+        {
+            clientTick -= error;
+            if (error > 0)
+            {
+                newestStamp = clientTick + tuning.inputDelay;
+            }
+        }
+        else if (error < 0)
+        {
+            due++;
+        }
+        else if (error > NET_BAND && due > 0)
+        {
+            due--;
+        }
+        else
+        {
+            return due;
+        }
+        adjustAfter = clientTick + tuning.inputDelay + 1;
+        slackFresh = false;
+        return due;
+    }
+
+public:
+    // telemetry may be NULL.
+    NetClient(NetTuning netTuning, Telemetry *t)
+        : tuning(netTuning), telemetry(t), player(-1), gameMode{2, Path::Regular, Difficulty::Easy, Program::Cpp},
+          tickRate(NET_TICK_RATE), interval(1), dt(1.0f / NET_TICK_RATE), playing(false), ended(false), helloAt(0),
+          heard(0), latestAt(0), clientTick(0), newestStamp(0), stampAck(0), adjustAfter(0), slack(NET_MARGIN),
+          slackFresh(false),
+          lastUpdate(0), accumulator(0), left(0, SCREEN_HEIGHT / 2),
+          right(SCREEN_WIDTH, SCREEN_HEIGHT / 2, false, Difficulty::Easy, NULL), localY(0), localPreviousY(0),
+          predicting(false)
+    {
+        memset(&server, 0, sizeof(server));
+        memset(states, 0xFF, sizeof(states));
+        memset(stamps, 0xFF, sizeof(stamps));
+        memset(predictedTicks, 0xFF, sizeof(predictedTicks));
+        memset(&previous, 0, sizeof(previous));
+        memset(&latest, 0, sizeof(latest));
+        tuning.inputDelay = tuning.inputDelay > 0 ? tuning.inputDelay : 0;
+        tuning.rollback = tuning.rollback > 0 ? tuning.rollback : 0;
+        tuning.rollback = tuning.rollback < NET_HISTORY / 2 ? tuning.rollback : NET_HISTORY / 2;
+    }
+
+    NetClient(const NetClient &) = delete;
+    NetClient &operator=(const NetClient &) = delete;
+
+    ~NetClient()
+    {
+        close();
+    }
+
+    // address is "host:port", "host" or ":port", NET_PORT on localhost by default.
+    bool open(const char *address, uint64_t seed)
+    {
+        socket.simulate(tuning.conditions, seed);
+        return parseAddress(address, "127.0.0.1", NET_PORT, &server) && socket.open(0);
+    }
+
+    // Says goodbye, so the server does not wait out NET_TIMEOUT.
+    void close()
+    {
+        unsigned char buffer[NET_PACKET];
+        NetWriter writer(buffer, sizeof(buffer));
+        writeHeader(&writer, NetBye);
+        if (player >= 0 && !ended)
+        {
+            socket.send(buffer, writer.getSize(), &server);
+        }
+        socket.close();
+        ended = true;
+    }
+
+    // Once per frame, or more often: takes in what the server sent, runs the
+    // ticks that are due with input (Input bits from this keyboard) and
+    // sends the buttons of every tick the server has not acknowledged.
+    void update(unsigned input)
+    {
+        if (ended)
+        {
+            return;
+        }
+        uint64_t now = nanoseconds();
+        receive(now);
+        if (player < 0)
+        {
+            if (now >= helloAt)
+            {
+                unsigned char buffer[NET_PACKET];
+                NetWriter writer(buffer, sizeof(buffer));
+                writeHeader(&writer, NetHello);
+                socket.send(buffer, writer.getSize(), &server);
+                helloAt = now + (uint64_t)(NET_HELLO * 1e9);
+            }
+        }
+        else if (playing)
+        {
+            int due = dueTicks(now);
+            for (int i = 0; i < due; i++)
+            {
+                tick(netButtons(input), now);
+            }
+            if (due > 0)
+            {
+                sendInput();
+            }
+        }
+        if (player >= 0 && now - heard > (uint64_t)(NET_TIMEOUT * 1e9))
+        {
+            ended = true;
+        }
+        socket.pump();
+    }
+
+    // Waits for the next datagram, or seconds at most.
+    void wait(double seconds)
+    {
+        socket.wait(seconds);
+    }
+
+    bool isWelcomed()
+    {
+        return player >= 0;
+    }
+
+    // Whether snapshots are coming in, so there is a match to draw.
+    bool isPlaying()
+    {
+        return playing && !ended;
+    }
+
+    bool hasEnded()
+    {
+        return ended;
+    }
+
+    // 0 for the left paddle, 1 for the right one, -1 before the welcome.
+    int getPlayer()
+    {
+        return player;
+    }
+
+    GameMode getGameMode()
+    {
+        return gameMode;
+    }
+
+    int getTickRate()
+    {
+        return tickRate;
+    }
+
+    int getLeftScore()
+    {
+        return latest.leftScore;
+    }
+
+    int getRightScore()
+    {
+        return latest.rightScore;
+    }
+
+    // The local paddle's center and the ball, as this client shows them.
+    float getPaddleCenter()
+    {
+        return localY + local()->getHeight() / 2;
+    }
+
+    float getBallX()
+    {
+        return latest.ballX / NET_POSITION;
+    }
+
+    float getBallY()
+    {
+        return latest.ballY / NET_POSITION;
+    }
+
+    // What to draw now, interpolated already: the draw code should use an
+    // alpha of 1. Leaves the chaos ball arrays alone.
+    void fill(Snapshot *snapshot)
+    {
+        float remote = (nanoseconds() - latestAt) / 1e9f / (interval * dt);
+        remote = remote < 1 ? remote : 1;
+        // The shorter way round, also when the angle wrapped past 65535
+        float turn = (int16_t)(latest.ballAngle - previous.ballAngle);
+        float ballX = (previous.ballX + (latest.ballX - previous.ballX) * remote) / NET_POSITION;
+        float ballY = (previous.ballY + (latest.ballY - previous.ballY) * remote) / NET_POSITION;
+        float angle = (previous.ballAngle + turn * remote) * (2 * PI / 65536);
+
+        float leftY = previous.leftY + (latest.leftY - previous.leftY) * remote;
+        float rightY = previous.rightY + (latest.rightY - previous.rightY) * remote;
+        if (predicting)
+        {
+            float localAlpha = accumulator / dt;
+            float y = localPreviousY + (localY - localPreviousY) * (localAlpha < 1 ? localAlpha : 1);
+            (player == 0 ? leftY : rightY) = y;
+        }
+
+        snapshot->tick = latest.tick;
+        snapshot->time = latestAt;
+        snapshot->alpha = 1;
+        snapshot->ball = BallState{ballX, ballY, ballX, ballY, angle};
+        snapshot->leftPaddle = PaddleState{left.getX(), leftY, leftY, (float)left.getWidth(), (float)left.getHeight()};
+        snapshot->rightPaddle = PaddleState{right.getX(), rightY, rightY, (float)right.getWidth(), (float)right.getHeight()};
+        snapshot->leftScore = latest.leftScore;
+        snapshot->rightScore = latest.rightScore;
+        snapshot->spin = 0;
+    }
+
+    // As of the last full second of ticks.
+    NetReport getTotal()
+    {
+        return statistics.getTotal();
+    }
+};
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "profiler.h"
+#include "replay.h"
+#include "simulation.h"
+
+// Input, simulation and rendering as three stages on two threads. The
+// render thread samples input every frame and pushes it into an SPSC ring;
+// the simulation thread drains the ring, runs the fixed ticks that are due
+// and publishes a Snapshot of everything drawn through a triple buffer; the
+// render thread draws the newest Snapshot. Neither side ever waits for the
+// other, so a slow frame no longer holds up the physics and input is picked
+// up within a tick instead of a frame. Every Snapshot carries when its
+// newest input was sampled and when a tick first used it, so the render
+// thread can measure input-to-tick and input-to-present latency. While
+// paused the simulation thread blocks instead of ticking, and the pause
+// does not count as simulated time.
+
+#define INPUT_RING 64
+
+//SPSC RING CLASS
+// Single producer, single consumer, N a power of two. push() fails when full.
+template <typename T, int N>
+class SpscRing
+{
+private:
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+    T items[N];
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    bool push(const T &item)
+    {
+        uint32_t next = head.load(std::memory_order_relaxed);
+        if (next - tail.load(std::memory_order_acquire) == N)
+        {
+            return false;
+        }
+        items[next & (N - 1)] = item;
+        head.store(next + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T *item)
+    {
+        uint32_t first = tail.load(std::memory_order_relaxed);
+        if (first == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        *item = items[first & (N - 1)];
+        tail.store(first + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+//TRIPLE BUFFER CLASS
+// One writer fills the back slot and publishes it; one reader takes the
+// newest published slot. The slots only change hands through one atomic
+// exchange of the middle index, whose FRESH bit says it has not been taken.
+template <typename T>
+class TripleBuffer
+{
+private:
+    static const int FRESH = 4;
+    T slots[3];
+    std::atomic<int> middle;
+    int back;
+    int front;
+
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    T *getSlot(int i)
+    {
+        return &slots[i];
+    }
+
+    // Writer side.
+    T *getBack()
+    {
+        return &slots[back];
+    }
+
+    void publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // Reader side: moves to the newest published slot, if there is one.
+    T *getFront()
+    {
+        if (middle.load(std::memory_order_relaxed) & FRESH)
+        {
+            front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        }
+        return &slots[front];
+    }
+};
+
+//STRUCTURS
+typedef struct InputSample
+{
+    unsigned input;
+    uint64_t time;
+} InputSample;
+
+typedef struct BallState
+{
+    float x;
+    float y;
+    float previousX;
+    float previousY;
+    float angle;
+} BallState;
+
+typedef struct PaddleState
+{
+    float x;
+    float y;
+    float previousY;
+    float width;
+    float height;
+} PaddleState;
+
+// Everything the render thread needs of one tick. Positions come with the
+// previous tick's for interpolation, angles at the tick and spin per tick.
+typedef struct Snapshot
+{
+    long tick;
+    uint64_t time;
+    float alpha;
+    uint64_t inputTime;
+    uint64_t tickTime;
+    BallState ball;
+    PaddleState leftPaddle;
+    PaddleState rightPaddle;
+    int leftScore;
+    int rightScore;
+    float spin;
+    int balls;
+    float *ballsX;
+    float *ballsY;
+    float *ballsPreviousX;
+    float *ballsPreviousY;
+    float *ballsAngle;
+    uint64_t zoneTotal[NumberOfZones];
+    uint64_t zoneCalls[NumberOfZones];
+} Snapshot;
+
+//PIPELINE CLASS
+class Pipeline
+{
+private:
+    Simulation *simulation;
+    Player *player1;
+    Player *player2;
+    ReplayWriter *replay;
+    Profiler *simulationProfiler;
+
+    SpscRing<InputSample, INPUT_RING> inputs;
+    TripleBuffer<Snapshot> snapshots;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<bool> paused;
+    std::mutex pauseMutex;
+    std::condition_variable resumed;
+
+    uint64_t chargedTotal[NumberOfZones];
+    uint64_t chargedCalls[NumberOfZones];
+
+    static PaddleState paddleState(Paddle *paddle)
+    {
+        PaddleState state = {paddle->getX(), paddle->getY(), paddle->interpolateY(0),
+                             (float)paddle->getWidth(), (float)paddle->getHeight()};
+        return state;
+    }
+
+    void fill(Snapshot *snapshot, uint64_t inputTime, uint64_t tickTime)
+    {
+        Ball *ball = simulation->getBall();
+        BallSystem *balls = simulation->getBalls();
+
+        snapshot->tick = simulation->getTick();
+        snapshot->time = nanoseconds();
+        snapshot->alpha = simulation->alpha();
+        snapshot->inputTime = inputTime;
+        snapshot->tickTime = tickTime;
+        snapshot->ball = BallState{ball->interpolateX(1), ball->interpolateY(1), ball->interpolateX(0),
+                                   ball->interpolateY(0), ball->rotationAngle(1)};
+        snapshot->leftPaddle = paddleState(simulation->getLeftPaddle());
+        snapshot->rightPaddle = paddleState(simulation->getRightPaddle());
+        snapshot->leftScore = player1->getScore();
+        snapshot->rightScore = player2->getScore();
+        snapshot->spin = simulation->getDt() * FPS * 0.1f;
+        for (int i = 0; i < snapshot->balls; i++)
+        {
+            snapshot->ballsX[i] = balls->getX(i);
+            snapshot->ballsY[i] = balls->getY(i);
+            snapshot->ballsPreviousX[i] = balls->interpolateX(i, 0);
+            snapshot->ballsPreviousY[i] = balls->interpolateY(i, 0);
+            snapshot->ballsAngle[i] = balls->rotationAngle(i, 1);
+        }
+        for (int i = 0; i < NumberOfZones; i++)
+        {
+            snapshot->zoneTotal[i] = simulationProfiler->getTotal((Zone)i);
+            snapshot->zoneCalls[i] = simulationProfiler->getCalls((Zone)i);
+        }
+    }
+
+    // Simulation thread: sleeps until the next tick is due, runs what is due
+    // with the newest input and publishes the result.
+    void run()
+    {
+        unsigned input = 0;
+        uint64_t inputTime = 0;
+        uint64_t tickTime = 0;
+        bool applied = true;
+        uint64_t last = nanoseconds();
+
+        while (running.load(std::memory_order_acquire))
+        {
+            if (paused.load(std::memory_order_acquire))
+            {
+                std::unique_lock<std::mutex> lock(pauseMutex);
+                resumed.wait(lock, [this]() { return !paused.load() || !running.load(); });
+                last = nanoseconds();
+                continue;
+            }
+
+            InputSample sample;
+            while (inputs.pop(&sample))
+            {
+                input = sample.input;
+                inputTime = sample.time;
+                applied = false;
+            }
+
+            uint64_t now = nanoseconds();
+            int ticks = simulation->advance((now - last) / 1e9f, input);
+            last = now;
+            if (ticks > 0)
+            {
+                if (replay)
+                {
+                    replay->record(input, ticks);
+                }
+                if (!applied)
+                {
+                    tickTime = nanoseconds();
+                    applied = true;
+                }
+                fill(snapshots.getBack(), inputTime, tickTime);
+                snapshots.publish();
+            }
+
+            float wait = simulation->getDt() * (1 - simulation->alpha());
+            std::this_thread::sleep_for(std::chrono::nanoseconds((long)(wait * 1e9f)));
+        }
+    }
+
+public:
+    // The simulation must profile into simulationProfiler, which only the
+    // simulation thread touches once start() has been called.
+    Pipeline(Simulation *s, Player *p1, Player *p2, ReplayWriter *r, Profiler *sP)
+        : simulation(s), player1(p1), player2(p2), replay(r), simulationProfiler(sP), running(false), paused(false)
+    {
+        int count = simulation->getBalls()->getCount();
+        for (int i = 0; i < 3; i++)
+        {
+            Snapshot *snapshot = snapshots.getSlot(i);
+            snapshot->balls = count;
+            snapshot->ballsX = (float *)malloc(count * sizeof(float));
+            snapshot->ballsY = (float *)malloc(count * sizeof(float));
+            snapshot->ballsPreviousX = (float *)malloc(count * sizeof(float));
+            snapshot->ballsPreviousY = (float *)malloc(count * sizeof(float));
+            snapshot->ballsAngle = (float *)malloc(count * sizeof(float));
+            fill(snapshot, 0, 0);
+        }
+        memset(chargedTotal, 0, sizeof(chargedTotal));
+        memset(chargedCalls, 0, sizeof(chargedCalls));
+    }
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    ~Pipeline()
+    {
+        stop();
+        for (int i = 0; i < 3; i++)
+        {
+            Snapshot *snapshot = snapshots.getSlot(i);
+            free(snapshot->ballsX);
+            free(snapshot->ballsY);
+            free(snapshot->ballsPreviousX);
+            free(snapshot->ballsPreviousY);
+            free(snapshot->ballsAngle);
+        }
+    }
+
+    void start()
+    {
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&Pipeline::run, this);
+    }
+
+    // After stop() the simulation is the caller's again.
+    void stop()
+    {
+        if (thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(pauseMutex);
+                running.store(false, std::memory_order_release);
+            }
+            resumed.notify_one();
+            thread.join();
+        }
+    }
+
+    // Render thread: stops or restarts the simulation clock.
+    void setPaused(bool pause)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pauseMutex);
+            paused.store(pause, std::memory_order_release);
+        }
+        resumed.notify_one();
+    }
+
+    // Render thread: hands this frame's input to the simulation.
+    void submit(unsigned input)
+    {
+        InputSample sample = {input, nanoseconds()};
+        // Only full when the simulation thread is stalled, and then the input is stale anyway
+        inputs.push(sample);
+    }
+
+    // Render thread: the newest Snapshot. The simulation's zone time since
+    // the last call is charged to profiler, so per-frame zone totals still
+    // cover the physics.
+    const Snapshot *acquire(Profiler *profiler)
+    {
+        const Snapshot *snapshot = snapshots.getFront();
+        for (int i = 0; i < NumberOfZones; i++)
+        {
+            if (snapshot->zoneCalls[i] > chargedCalls[i])
+            {
+                profiler->add((Zone)i, snapshot->zoneTotal[i] - chargedTotal[i], snapshot->zoneCalls[i] - chargedCalls[i]);
+                chargedTotal[i] = snapshot->zoneTotal[i];
+                chargedCalls[i] = snapshot->zoneCalls[i];
+            }
+        }
+        return snapshot;
+    }
+
+    // How far past snapshot's tick the simulation is by now, in ticks, for interpolation.
+    float alpha(const Snapshot *snapshot)
+    {
+        float alpha = snapshot->alpha + (nanoseconds() - snapshot->time) / 1e9f / simulation->getDt();
+        return alpha < 1 ? alpha : 1;
+    }
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#include <math.h>
+#include "kernels.h"
+
+// Where the ball will cross a vertical line, for the AI paddle. Regular and
+// Sin have closed forms: x and |y velocity| both grow linearly with the
+// difficulty acceleration up to the speed cap, which gives the flight time
+// and distance in O(1); Sin multiplies the y velocity by sin(0.05 * round),
+// which integrates by parts. The walls are mirrors, so y is followed
+// unfolded and folded back into the court at the end. Curve's pull depends
+// on where the ball is, so it is integrated in frame-sized steps instead;
+// the caller only predicts again after a bounce, which keeps that O(1) per
+// tick amortized over the flight.
+
+#define PREDICT_MAX_STEPS (10 * FPS)
+#define SIN_FREQUENCY (0.05f * FPS)
+
+//STRUCTURS
+// The ball's state in the units Ball uses: pixels, pixels per second and
+// seconds. accelerationX/Y grow the speed along the direction of travel.
+typedef struct Trajectory
+{
+    float x;
+    float y;
+    float velocityX;
+    float velocityY;
+    float accelerationX;
+    float accelerationY;
+    float curveAcceleration;
+    float time;
+    float radius;
+    float maxSpeed;
+} Trajectory;
+
+// How well the AI plays. It only looks once the ball is past vision of the
+// court from the far side, reacts reaction seconds after a bounce, aims up
+// to error pixels off and moves at speed of the paddle's top speed.
+typedef struct AiModel
+{
+    float vision;
+    float reaction;
+    int error;
+    float speed;
+    bool recenter;
+} AiModel;
+
+inline AiModel aiModel(Difficulty difficulty)
+{
+    switch (difficulty)
+    {
+    case Difficulty::Meduim:
+        return AiModel{0.35f, 0.12f, 30, 0.85f, true};
+    case Difficulty::Hard:
+        return AiModel{0.0f, 0.05f, 10, 1.0f, true};
+    default:
+        return AiModel{0.5f, 0.25f, 55, 0.7f, false};
+    }
+}
+
+// Distance covered in time starting at speed, gaining acceleration per
+// second up to maxSpeed.
+inline float travel(float time, float speed, float acceleration, float maxSpeed)
+{
+    if (acceleration <= 0 || speed >= maxSpeed)
+    {
+        return speed * time;
+    }
+    float capTime = (maxSpeed - speed) / acceleration;
+    if (time <= capTime)
+    {
+        return speed * time + 0.5f * acceleration * time * time;
+    }
+    return speed * capTime + 0.5f * acceleration * capTime * capTime + maxSpeed * (time - capTime);
+}
+
+// The inverse of travel(): how long it takes to cover distance.
+inline float travelTime(float distance, float speed, float acceleration, float maxSpeed)
+{
+    if (acceleration <= 0 || speed >= maxSpeed)
+    {
+        return distance / speed;
+    }
+    float capTime = (maxSpeed - speed) / acceleration;
+    float capDistance = speed * capTime + 0.5f * acceleration * capTime * capTime;
+    if (distance <= capDistance)
+    {
+        return (sqrtf(speed * speed + 2 * acceleration * distance) - speed) / acceleration;
+    }
+    return capTime + (distance - capDistance) / maxSpeed;
+}
+
+// Integral over [0, time] of speed(t) * sin(frequency * (phase + t)), where
+// speed(t) is speed + acceleration * t up to maxSpeed.
+inline float sinTravel(float time, float speed, float acceleration, float maxSpeed, float phase, float frequency)
+{
+    float capTime = acceleration > 0 && speed < maxSpeed ? (maxSpeed - speed) / acceleration : 0;
+    if (time > capTime && capTime > 0)
+    {
+        return sinTravel(capTime, speed, acceleration, maxSpeed, phase, frequency) +
+               sinTravel(time - capTime, maxSpeed, 0, maxSpeed, phase + capTime, frequency);
+    }
+    if (speed >= maxSpeed)
+    {
+        acceleration = 0;
+    }
+    float start = frequency * phase;
+    float end = frequency * (phase + time);
+    float square = frequency * frequency;
+    return (-(speed + acceleration * time) * cosf(end) + speed * cosf(start)) / frequency +
+           acceleration * (sinf(end) - sinf(start)) / square;
+}
+
+// Folds an unfolded y back between the walls, as the ball center sees them.
+inline float foldY(float y, float radius)
+{
+    float span = SCREEN_HEIGHT - 2 * radius;
+    float offset = fmodf(y - radius, 2 * span);
+    offset = offset < 0 ? offset + 2 * span : offset;
+    return radius + (offset > span ? 2 * span - offset : offset);
+}
+
+inline float curveIntercept(const Trajectory *trajectory, float targetX, GameMode *gameMode, float *time)
+{
+    const float step = 1.0f / FPS;
+    float x = trajectory->x;
+    float y = trajectory->y;
+    float velocityX = trajectory->velocityX;
+    float velocityY = trajectory->velocityY;
+    float curveAcceleration = trajectory->curveAcceleration;
+    float low = trajectory->radius;
+    float high = SCREEN_HEIGHT - trajectory->radius;
+    int steps = 0;
+
+    // The same order as Ball::path(): velocity with the old pull, then the pull, then the move
+    while (x < targetX && steps < PREDICT_MAX_STEPS)
+    {
+        velocityX += copysignf(trajectory->accelerationX * step, velocityX);
+        velocityY += copysignf(trajectory->accelerationY * step, velocityY) + curveAcceleration * step;
+        velocityX = fminf(velocityX, trajectory->maxSpeed);
+        velocityY = fminf(fmaxf(velocityY, -trajectory->maxSpeed), trajectory->maxSpeed);
+        curveAcceleration += curvePath((int)x, (int)y, gameMode);
+        x += velocityX * step;
+        y += velocityY * step;
+        if (y < low)
+        {
+            y = 2 * low - y;
+            velocityY = fabsf(velocityY);
+        }
+        else if (y > high)
+        {
+            y = 2 * high - y;
+            velocityY = -fabsf(velocityY);
+        }
+        steps++;
+    }
+    *time = steps * step;
+    return y;
+}
+
+// The ball center's y when it reaches targetX, and in *time how long until
+// then. The ball must be heading towards targetX.
+inline float predictIntercept(const Trajectory *trajectory, float targetX, GameMode *gameMode, float *time)
+{
+    if (gameMode->path == Path::Curve)
+    {
+        return curveIntercept(trajectory, targetX, gameMode, time);
+    }
+
+    float distance = fabsf(targetX - trajectory->x);
+    *time = travelTime(distance, fabsf(trajectory->velocityX), trajectory->accelerationX, trajectory->maxSpeed);
+
+    float speedY = fabsf(trajectory->velocityY);
+    float directionY = trajectory->velocityY < 0 ? -1 : 1;
+    float offset;
+    if (gameMode->path == Path::Sin)
+    {
+        offset = sinTravel(*time, speedY, trajectory->accelerationY, trajectory->maxSpeed, trajectory->time, SIN_FREQUENCY);
+    }
+    else
+    {
+        offset = travel(*time, speedY, trajectory->accelerationY, trajectory->maxSpeed);
+    }
+    return foldY(trajectory->y + directionY * offset, trajectory->radius);
+}
+
+#endif
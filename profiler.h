@@ -0,0 +1,278 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+// Hot-path instrumentation on a monotonic clock. Timings are accumulated per
+// zone, and at the end of every frame the per-zone frame totals are pushed into
+// histograms so p50/p99/max can be reported per frame.
+
+enum Zone
+{
+    PathZone,
+    DrawZone,
+    GradientZone,
+    CollisionZone,
+    NumberOfZones
+};
+
+inline const char *zoneName(Zone zone)
+{
+    static const char *names[NumberOfZones] = {"path", "draw", "gradient", "collision"};
+    return names[zone];
+}
+
+inline uint64_t nanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+//HISTOGRAM CLASS
+// Log-linear buckets: 16 linear sub-buckets per power of two, so any recorded
+// value is reported within ~6% while the memory stays fixed.
+#define HISTOGRAM_SUB_BUCKETS 16
+#define HISTOGRAM_BUCKETS (61 * HISTOGRAM_SUB_BUCKETS)
+
+class Histogram
+{
+private:
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t max;
+
+    static int bucketOf(uint64_t value)
+    {
+        if (value < HISTOGRAM_SUB_BUCKETS)
+        {
+            return (int)value;
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        int sub = (int)((value >> (exponent - 4)) & (HISTOGRAM_SUB_BUCKETS - 1));
+        return (exponent - 3) * HISTOGRAM_SUB_BUCKETS + sub;
+    }
+
+    static uint64_t lowerBound(int bucket)
+    {
+        if (bucket < HISTOGRAM_SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        int exponent = bucket / HISTOGRAM_SUB_BUCKETS + 3;
+        uint64_t sub = bucket % HISTOGRAM_SUB_BUCKETS;
+        return (HISTOGRAM_SUB_BUCKETS + sub) << (exponent - 4);
+    }
+
+public:
+    Histogram()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        memset(buckets, 0, sizeof(buckets));
+        count = 0;
+        max = 0;
+    }
+
+    void record(uint64_t value)
+    {
+        buckets[bucketOf(value)]++;
+        count++;
+        if (value > max)
+        {
+            max = value;
+        }
+    }
+
+    void merge(const Histogram &other)
+    {
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        if (other.max > max)
+        {
+            max = other.max;
+        }
+    }
+
+    // p in [0, 1]; returns the middle of the bucket holding that rank.
+    uint64_t percentile(double p) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(p * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+            {
+                uint64_t low = lowerBound(i);
+                uint64_t high = lowerBound(i + 1);
+                uint64_t middle = low + (high - low) / 2;
+                return middle < max ? middle : max;
+            }
+        }
+        return max;
+    }
+
+    uint64_t getCount() const
+    {
+        return count;
+    }
+
+    uint64_t getMax() const
+    {
+        return max;
+    }
+};
+
+//PROFILER CLASS
+class Profiler
+{
+private:
+    uint64_t total[NumberOfZones];
+    uint64_t calls[NumberOfZones];
+    uint64_t frame[NumberOfZones];
+    uint64_t previousFrame[NumberOfZones];
+    Histogram zoneHistograms[NumberOfZones];
+    Histogram frameHistogram;
+    uint64_t frames;
+    uint64_t lastFrame;
+    uint64_t frameTime;
+
+public:
+    Profiler() : frames(0), lastFrame(0), frameTime(0)
+    {
+        memset(total, 0, sizeof(total));
+        memset(calls, 0, sizeof(calls));
+        memset(frame, 0, sizeof(frame));
+        memset(previousFrame, 0, sizeof(previousFrame));
+    }
+
+    void add(Zone zone, uint64_t elapsed)
+    {
+        total[zone] += elapsed;
+        frame[zone] += elapsed;
+        calls[zone]++;
+    }
+
+    // Time measured elsewhere, such as by another thread's profiler.
+    void add(Zone zone, uint64_t elapsed, uint64_t count)
+    {
+        total[zone] += elapsed;
+        frame[zone] += elapsed;
+        calls[zone] += count;
+    }
+
+    // Closes the current frame: per-zone frame totals go into the histograms.
+    void endFrame()
+    {
+        uint64_t now = nanoseconds();
+        frameTime = lastFrame != 0 ? now - lastFrame : 0;
+        if (lastFrame != 0)
+        {
+            frameHistogram.record(frameTime);
+        }
+        lastFrame = now;
+
+        for (int i = 0; i < NumberOfZones; i++)
+        {
+            zoneHistograms[i].record(frame[i]);
+            previousFrame[i] = frame[i];
+            frame[i] = 0;
+        }
+        frames++;
+    }
+
+    // The next endFrame() starts a new frame time instead of measuring
+    // from the last one, as after a pause.
+    void restartFrameClock()
+    {
+        lastFrame = 0;
+    }
+
+    uint64_t getTotal(Zone zone) const
+    {
+        return total[zone];
+    }
+
+    uint64_t getTotal() const
+    {
+        uint64_t sum = 0;
+        for (int i = 0; i < NumberOfZones; i++)
+        {
+            sum += total[i];
+        }
+        return sum;
+    }
+
+    uint64_t getCalls(Zone zone) const
+    {
+        return calls[zone];
+    }
+
+    uint64_t getFrame(Zone zone) const
+    {
+        return frame[zone];
+    }
+
+    // Zone time of the frame endFrame() last closed.
+    uint64_t getPreviousFrame(Zone zone) const
+    {
+        return previousFrame[zone];
+    }
+
+    // Wall time between the last two endFrame() calls; 0 after the first.
+    uint64_t getFrameTime() const
+    {
+        return frameTime;
+    }
+
+    uint64_t getFrames() const
+    {
+        return frames;
+    }
+
+    const Histogram &getHistogram(Zone zone) const
+    {
+        return zoneHistograms[zone];
+    }
+
+    const Histogram &getFrameHistogram() const
+    {
+        return frameHistogram;
+    }
+};
+
+//SCOPED TIMER CLASS
+// A null profiler turns the timer into a no-op, so headless code can skip it.
+class ScopedTimer
+{
+private:
+    Profiler *profiler;
+    Zone zone;
+    uint64_t start;
+
+public:
+    ScopedTimer(Profiler *p, Zone z) : profiler(p), zone(z), start(p ? nanoseconds() : 0) {}
+
+    ~ScopedTimer()
+    {
+        if (profiler)
+        {
+            profiler->add(zone, nanoseconds() - start);
+        }
+    }
+};
+
+#endif
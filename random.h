@@ -0,0 +1,64 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+//RANDOM CLASS
+// Seeded xorshift64* generator, a deterministic stand-in for GetRandomValue
+// wherever runs have to be reproducible.
+class Random
+{
+private:
+    uint64_t state;
+
+public:
+    Random(uint64_t seed = 1)
+    {
+        setSeed(seed);
+    }
+
+    void setSeed(uint64_t seed)
+    {
+        // splitmix64 so that neighbouring seeds give unrelated streams
+        seed += 0x9E3779B97F4A7C15ull;
+        seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ull;
+        seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBull;
+        state = (seed ^ (seed >> 31)) | 1;
+    }
+
+    uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    // Same contract as GetRandomValue: min and max are both inclusive.
+    int value(int min, int max)
+    {
+        if (max < min)
+        {
+            int swap = min;
+            min = max;
+            max = swap;
+        }
+        uint64_t range = (uint64_t)((int64_t)max - min) + 1;
+        return (int)(min + (int64_t)(next() % range));
+    }
+
+    // Uniform in [min, max).
+    float uniform(float min, float max)
+    {
+        return min + (max - min) * ((next() >> 40) * (1.0f / 16777216.0f));
+    }
+};
+
+//PLATFORM
+// Platform::randomValue for a Random passed as the context.
+inline int seededRandomValue(void *context, int min, int max)
+{
+    return ((Random *)context)->value(min, max);
+}
+
+#endif
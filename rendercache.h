@@ -0,0 +1,105 @@
+#ifndef RENDERCACHE_H
+#define RENDERCACHE_H
+
+#include "raylib.h"
+
+// Static decorations (the court, its gradient circle and center line) are
+// drawn once into a RenderTexture2D and blitted every frame after that. The
+// cache is keyed on the screen size and a palette key; when either changes,
+// or invalidate() is called, begin() hands the texture back for re-baking.
+
+// FNV-1a over the colors a cached drawing uses.
+inline unsigned paletteKey(const Color *colors, int count)
+{
+    unsigned key = 2166136261u;
+    for (int i = 0; i < count; i++)
+    {
+        unsigned char channels[4] = {colors[i].r, colors[i].g, colors[i].b, colors[i].a};
+        for (int j = 0; j < 4; j++)
+        {
+            key = (key ^ channels[j]) * 16777619u;
+        }
+    }
+    return key;
+}
+
+//RENDER CACHE CLASS
+class RenderCache
+{
+private:
+    RenderTexture2D texture;
+    bool loaded;
+    bool stale;
+    int width;
+    int height;
+    unsigned palette;
+
+public:
+    RenderCache() : loaded(false), stale(true), width(0), height(0), palette(0) {}
+
+    RenderCache(const RenderCache &) = delete;
+    RenderCache &operator=(const RenderCache &) = delete;
+
+    // Must go before CloseWindow().
+    ~RenderCache()
+    {
+        if (loaded)
+        {
+            UnloadRenderTexture(texture);
+        }
+    }
+
+    // Returns true and starts drawing into the cache when it has to be
+    // re-baked; the caller draws and then calls end(). Returns false when the
+    // baked texture is still good. Call it outside BeginDrawing().
+    bool begin(int screenWidth, int screenHeight, unsigned paletteKey)
+    {
+        if (!stale && loaded && screenWidth == width && screenHeight == height && paletteKey == palette)
+        {
+            return false;
+        }
+
+        if (loaded && (screenWidth != width || screenHeight != height))
+        {
+            UnloadRenderTexture(texture);
+            loaded = false;
+        }
+        if (!loaded)
+        {
+            texture = LoadRenderTexture(screenWidth, screenHeight);
+            loaded = true;
+        }
+
+        width = screenWidth;
+        height = screenHeight;
+        palette = paletteKey;
+        stale = false;
+        BeginTextureMode(texture);
+        return true;
+    }
+
+    // Starts drawing over part of a texture begin() has just said is still
+    // good; the caller draws and then calls end().
+    void patch()
+    {
+        BeginTextureMode(texture);
+    }
+
+    void end()
+    {
+        EndTextureMode();
+    }
+
+    void invalidate()
+    {
+        stale = true;
+    }
+
+    void draw()
+    {
+        // Render textures are stored upside down, hence the negative height
+        DrawTextureRec(texture.texture, Rectangle{0, 0, (float)width, (float)-height}, Vector2{0, 0}, WHITE);
+    }
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "simulation.h"
+
+// A replay is everything a Simulation needs to redo a match bit for bit:
+// the Random seed, the GameMode, the tick rate, the chaos ball count and the
+// Input bitmask of every tick. The file is a ReplayHeader followed by runs,
+// one byte of Input bits and a LEB128 tick count each, so a held key costs a
+// couple of bytes whatever the tick rate. Integers are little-endian.
+// ReplayWriter streams the runs out as the match goes; ticks, the checksum
+// of the final state and the closed flag are patched into the header by
+// close(), and a replay that was never closed still plays, only without the
+// check.
+
+#define REPLAY_MAGIC "PRPL"
+#define REPLAY_VERSION 4
+
+//STRUCTURS
+typedef struct ReplayHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t seed;
+    int32_t numberOfPlayer;
+    int32_t path;
+    int32_t difficulty;
+    int32_t program;
+    int32_t tickRate;
+    int32_t chaosBalls;
+    uint64_t ticks;
+    uint64_t checksum;
+    uint32_t closed;
+} ReplayHeader;
+
+//CHECKSUM
+inline uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Hash of the exact bits of everything a tick changes.
+inline uint64_t simulationChecksum(Simulation *simulation, Player *player1, Player *player2)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    Ball *ball = simulation->getBall();
+    BallSystem *balls = simulation->getBalls();
+    long tick = simulation->getTick();
+    float state[6] = {ball->getX(), ball->getY(), ball->getVelocityX(), ball->getVelocityY(),
+                      simulation->getLeftPaddle()->getY(), simulation->getRightPaddle()->getY()};
+    int scores[2] = {player1->getScore(), player2->getScore()};
+
+    hash = fnv1a(hash, &tick, sizeof(tick));
+    hash = fnv1a(hash, state, sizeof(state));
+    hash = fnv1a(hash, scores, sizeof(scores));
+    for (int i = 0; i < balls->getCount(); i++)
+    {
+        float position[2] = {balls->getX(i), balls->getY(i)};
+        hash = fnv1a(hash, position, sizeof(position));
+    }
+    return hash;
+}
+
+//REPLAY WRITER CLASS
+class ReplayWriter
+{
+private:
+    FILE *file;
+    ReplayHeader header;
+    unsigned input;
+    uint64_t run;
+
+    void writeRun()
+    {
+        if (run == 0)
+        {
+            return;
+        }
+        unsigned char bytes[11];
+        int size = 0;
+        bytes[size++] = (unsigned char)input;
+        uint64_t length = run;
+        do
+        {
+            bytes[size] = length & 0x7F;
+            length >>= 7;
+            bytes[size++] |= length ? 0x80 : 0;
+        } while (length);
+        fwrite(bytes, 1, size, file);
+        run = 0;
+    }
+
+public:
+    ReplayWriter() : file(NULL), input(0), run(0) {}
+
+    ReplayWriter(const ReplayWriter &) = delete;
+    ReplayWriter &operator=(const ReplayWriter &) = delete;
+
+    ~ReplayWriter()
+    {
+        if (file)
+        {
+            writeRun();
+            fclose(file);
+        }
+    }
+
+    bool open(const char *path, uint64_t seed, GameMode *gameMode, int tickRate, int chaosBalls)
+    {
+        file = fopen(path, "wb");
+        if (!file)
+        {
+            return false;
+        }
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, REPLAY_MAGIC, 4);
+        header.version = REPLAY_VERSION;
+        header.seed = seed;
+        header.numberOfPlayer = gameMode->numberOfPlayer;
+        header.path = gameMode->path;
+        header.difficulty = gameMode->difficulty;
+        header.program = gameMode->program;
+        header.tickRate = tickRate;
+        header.chaosBalls = chaosBalls;
+        input = 0;
+        run = 0;
+        return fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    // ticks ticks all stepped with the same input.
+    void record(unsigned tickInput, int ticks)
+    {
+        if (!file || ticks <= 0)
+        {
+            return;
+        }
+        tickInput &= InputW | InputS | InputUp | InputDown;
+        if (tickInput != input)
+        {
+            writeRun();
+            input = tickInput;
+        }
+        run += ticks;
+        header.ticks += ticks;
+    }
+
+    // Finishes the file; checksum is simulationChecksum() after the last tick.
+    bool close(uint64_t checksum)
+    {
+        if (!file)
+        {
+            return false;
+        }
+        writeRun();
+        header.checksum = checksum;
+        header.closed = 1;
+        bool ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+        ok = fclose(file) == 0 && ok;
+        file = NULL;
+        return ok;
+    }
+};
+
+//REPLAY READER CLASS
+class ReplayReader
+{
+private:
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+    ReplayHeader header;
+    unsigned input;
+    uint64_t run;
+
+public:
+    ReplayReader() : data(NULL), size(0), offset(0), input(0), run(0) {}
+
+    ReplayReader(const ReplayReader &) = delete;
+    ReplayReader &operator=(const ReplayReader &) = delete;
+
+    ~ReplayReader()
+    {
+        if (data)
+        {
+            munmap((void *)data, size);
+        }
+    }
+
+    bool open(const char *path)
+    {
+        int descriptor = ::open(path, O_RDONLY);
+        if (descriptor < 0)
+        {
+            return false;
+        }
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || (size_t)status.st_size < sizeof(ReplayHeader))
+        {
+            ::close(descriptor);
+            return false;
+        }
+        size = status.st_size;
+        void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+        data = (const unsigned char *)mapping;
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        memcpy(&header, data, sizeof(header));
+        offset = sizeof(header);
+        input = 0;
+        run = 0;
+        return !memcmp(header.magic, REPLAY_MAGIC, 4) && header.version == REPLAY_VERSION && header.tickRate > 0;
+    }
+
+    // The next tick's input; false once the replay is over.
+    bool next(unsigned *tickInput)
+    {
+        while (run == 0)
+        {
+            if (offset >= size)
+            {
+                return false;
+            }
+            input = data[offset++];
+            int shift = 0;
+            unsigned char byte;
+            do
+            {
+                if (offset >= size || shift > 63)
+                {
+                    return false;
+                }
+                byte = data[offset++];
+                run |= (uint64_t)(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+        }
+        run--;
+        *tickInput = input;
+        return true;
+    }
+
+    uint64_t getSeed()
+    {
+        return header.seed;
+    }
+
+    GameMode getGameMode()
+    {
+        GameMode gameMode = {header.numberOfPlayer, (Path)header.path, (Difficulty)header.difficulty, (Program)header.program};
+        return gameMode;
+    }
+
+    int getTickRate()
+    {
+        return header.tickRate;
+    }
+
+    int getChaosBalls()
+    {
+        return header.chaosBalls;
+    }
+
+    // 0 when the writer was never closed.
+    uint64_t getTicks()
+    {
+        return header.ticks;
+    }
+
+    // False when the writer was never closed, so there is nothing to check against.
+    bool hasChecksum()
+    {
+        return header.closed != 0;
+    }
+
+    uint64_t getChecksum()
+    {
+        return header.checksum;
+    }
+};
+
+#endif
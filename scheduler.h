@@ -0,0 +1,145 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "raylib.h"
+#include "profiler.h"
+#include "telemetry.h"
+
+// Decides, on every pass of a render loop, whether there is anything new to
+// draw. A scene that animates calls requestRedraw() every pass and runs at
+// the frame cap as before. A static one stops drawing and calls idle()
+// instead, which blocks in the windowing system until an input event
+// arrives. A scene with a timer sets it again every pass with wakeAt();
+// idle() then sleeps in slices of at most SCHEDULER_SLICE so that input is
+// still picked up, and returns once the timer is due. Busy time is
+// everything outside those waits and outside EndDrawing(), which sleeps
+// for the frame cap and the swap; the duty cycle is busy over wall time.
+
+#define SCHEDULER_SLICE (1.0 / 30)
+
+//STRUCTURS
+// How a render loop spent its wall time.
+typedef struct ScheduleReport
+{
+    double seconds;
+    double busySeconds;
+    double dutyCycle;
+    uint64_t frames;
+    uint64_t wakeups;
+} ScheduleReport;
+
+//FRAME SCHEDULER CLASS
+class FrameScheduler
+{
+private:
+    bool redraw;
+    double deadline;
+    uint64_t started;
+    uint64_t mark;
+    uint64_t busy;
+    uint64_t frames;
+    uint64_t wakeups;
+
+    void stopClock()
+    {
+        busy += nanoseconds() - mark;
+    }
+
+public:
+    FrameScheduler() : redraw(true), deadline(0), started(nanoseconds()), mark(started), busy(0), frames(0), wakeups(0) {}
+
+    // Starts the counts over and draws the next pass, for a new scene.
+    void restart()
+    {
+        redraw = true;
+        deadline = 0;
+        started = nanoseconds();
+        mark = started;
+        busy = 0;
+        frames = 0;
+        wakeups = 0;
+    }
+
+    void requestRedraw()
+    {
+        redraw = true;
+    }
+
+    // A timer at time, in GetTime() seconds, for the next idle() only.
+    void wakeAt(double time)
+    {
+        if (deadline == 0 || time < deadline)
+        {
+            deadline = time;
+        }
+    }
+
+    // Whether this pass draws a frame, ended with endDrawing(); if not, the
+    // pass should end with idle().
+    bool shouldDraw()
+    {
+        bool draw = redraw;
+        redraw = false;
+        return draw;
+    }
+
+    void endDrawing()
+    {
+        stopClock();
+        EndDrawing();
+        frames++;
+        mark = nanoseconds();
+    }
+
+    void idle()
+    {
+        stopClock();
+        if (deadline > 0)
+        {
+            double wait = deadline - GetTime();
+            if (wait > 0)
+            {
+                WaitTime(wait < SCHEDULER_SLICE ? wait : SCHEDULER_SLICE);
+            }
+            PollInputEvents();
+        }
+        else
+        {
+            EnableEventWaiting();
+            PollInputEvents();
+            DisableEventWaiting();
+        }
+        deadline = 0;
+        wakeups++;
+        mark = nanoseconds();
+    }
+
+    ScheduleReport report()
+    {
+        uint64_t now = nanoseconds();
+        double seconds = (now - started) / 1e9;
+        double busySeconds = (busy + now - mark) / 1e9;
+        ScheduleReport report = {seconds, busySeconds, seconds > 0 ? busySeconds / seconds : 0, frames, wakeups};
+        return report;
+    }
+};
+
+//TELEMETRY
+// Defined here rather than in telemetry.h, which the raylib-free headless
+// build includes too. Goes out as one fprintf, so it waits for the writer
+// thread to end the frame line it is on rather than splitting it.
+inline void Telemetry::schedule(const char *scene, const ScheduleReport *report)
+{
+    if (!file)
+    {
+        return;
+    }
+    fprintf(file,
+            "{\"type\": \"schedule\", \"session\": %llu, \"scene\": \"%s\", \"seconds\": %.3f, "
+            "\"busy_s\": %.3f, \"duty_cycle\": %.5f, \"frames\": %llu, \"wakeups\": %llu}\n",
+            session.id, scene, report->seconds, report->busySeconds, report->dutyCycle,
+            (unsigned long long)report->frames, (unsigned long long)report->wakeups);
+}
+
+#endif
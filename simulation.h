@@ -0,0 +1,1434 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "kernels.h"
+#include "predictor.h"
+#include "profiler.h"
+#include "spatialgrid.h"
+
+// The game's physics without raylib. Everything steps on a fixed dt chosen
+// by the tick rate, positions are floats, and the platform (random numbers,
+// keyboard) is injected through Platform so the same code runs in the
+// window or headless.
+
+#define TICK_RATE 1000
+#define MAX_FRAME_TIME 0.25f
+#define MAX_SPEED 1200
+#define BALL_BLOCK 256
+#define MAX_IMPACTS 4
+#define MAX_OBSTACLES 128
+
+//STRUCTURS
+enum Input
+{
+    InputW = 1,
+    InputS = 2,
+    InputUp = 4,
+    InputDown = 8
+};
+
+enum Event
+{
+    EventHit = 1,
+    EventPoint = 2
+};
+
+typedef struct Platform
+{
+    int (*randomValue)(void *context, int min, int max);
+    bool (*keyDown)(void *context, int key);
+    void *context;
+} Platform;
+
+typedef struct Obstacle
+{
+    float x;
+    float y;
+    float width;
+    float height;
+} Obstacle;
+
+typedef struct Keys
+{
+    int w;
+    int s;
+    int up;
+    int down;
+} Keys;
+
+// Samples the four paddle keys into an Input bitmask through the platform.
+inline unsigned sampleInput(Platform *platform, Keys keys)
+{
+    unsigned input = 0;
+    if (platform->keyDown(platform->context, keys.w))
+    {
+        input |= InputW;
+    }
+    if (platform->keyDown(platform->context, keys.s))
+    {
+        input |= InputS;
+    }
+    if (platform->keyDown(platform->context, keys.up))
+    {
+        input |= InputUp;
+    }
+    if (platform->keyDown(platform->context, keys.down))
+    {
+        input |= InputDown;
+    }
+    return input;
+}
+
+// Unlike fminf/fmaxf this never becomes a libm call, so loops using it vectorize.
+inline float clampf(float value, float low, float high)
+{
+    value = value < low ? low : value;
+    return value > high ? high : value;
+}
+
+inline bool circleRectangleOverlap(float centerX, float centerY, float radius,
+                                   float x, float y, float width, float height)
+{
+    float closestX = centerX < x ? x : centerX > x + width ? x + width : centerX;
+    float closestY = centerY < y ? y : centerY > y + height ? y + height : centerY;
+    float distanceX = centerX - closestX;
+    float distanceY = centerY - closestY;
+    return distanceX * distanceX + distanceY * distanceY <= radius * radius;
+}
+
+// Outward normal of the rectangle towards a circle center, and how far the
+// center is from the rectangle along it; negative when the center is inside,
+// where the normal points out through the nearest side.
+inline float contactNormal(float centerX, float centerY, float x, float y, float width, float height,
+                           float *normalX, float *normalY)
+{
+    float closestX = clampf(centerX, x, x + width);
+    float closestY = clampf(centerY, y, y + height);
+    float distance = sqrtf((centerX - closestX) * (centerX - closestX) + (centerY - closestY) * (centerY - closestY));
+    if (distance > 0)
+    {
+        *normalX = (centerX - closestX) / distance;
+        *normalY = (centerY - closestY) / distance;
+        return distance;
+    }
+
+    float distances[4] = {centerX - x, x + width - centerX, centerY - y, y + height - centerY};
+    float normals[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    int side = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (distances[i] < distances[side])
+        {
+            side = i;
+        }
+    }
+    *normalX = normals[side][0];
+    *normalY = normals[side][1];
+    return -distances[side];
+}
+
+// Time of impact of a circle moving by (moveX, moveY) against a rectangle, as
+// a fraction of the move, or a value above 1 when they do not touch within
+// it. The circle is a ray against the rectangle grown by the radius, with
+// rounded corners. normal is the rectangle's outward normal at the contact.
+// A circle that already overlaps reports 0, with the normal pushing it out,
+// but only while it is moving further in.
+inline float sweepCircleRectangle(float centerX, float centerY, float radius, float moveX, float moveY,
+                                  float x, float y, float width, float height, float *normalX, float *normalY)
+{
+    if (circleRectangleOverlap(centerX, centerY, radius, x, y, width, height))
+    {
+        contactNormal(centerX, centerY, x, y, width, height, normalX, normalY);
+        return moveX * *normalX + moveY * *normalY < 0 ? 0 : 2;
+    }
+
+    // Slabs of the grown rectangle
+    float enterX = -1e30f;
+    float exitX = 1e30f;
+    float enterY = -1e30f;
+    float exitY = 1e30f;
+    if (moveX != 0)
+    {
+        enterX = ((moveX > 0 ? x - radius : x + width + radius) - centerX) / moveX;
+        exitX = ((moveX > 0 ? x + width + radius : x - radius) - centerX) / moveX;
+    }
+    else if (centerX < x - radius || centerX > x + width + radius)
+    {
+        return 2;
+    }
+    if (moveY != 0)
+    {
+        enterY = ((moveY > 0 ? y - radius : y + height + radius) - centerY) / moveY;
+        exitY = ((moveY > 0 ? y + height + radius : y - radius) - centerY) / moveY;
+    }
+    else if (centerY < y - radius || centerY > y + height + radius)
+    {
+        return 2;
+    }
+    float enter = enterX > enterY ? enterX : enterY;
+    float exit = exitX < exitY ? exitX : exitY;
+    if (enter > exit || enter > 1 || exit < 0)
+    {
+        return 2;
+    }
+    // Starting inside the grown rectangle without overlapping means starting in a corner square
+    enter = enter > 0 ? enter : 0;
+
+    float hitX = centerX + moveX * enter;
+    float hitY = centerY + moveY * enter;
+    if ((hitX >= x && hitX <= x + width) || (hitY >= y && hitY <= y + height))
+    {
+        *normalX = enterX > enterY ? (moveX > 0 ? -1 : 1) : 0;
+        *normalY = enterX > enterY ? 0 : (moveY > 0 ? -1 : 1);
+        return enter;
+    }
+
+    // In a corner square the grown rectangle is the quarter circle around the corner
+    float cornerX = hitX < x ? x : x + width;
+    float cornerY = hitY < y ? y : y + height;
+    float offsetX = centerX - cornerX;
+    float offsetY = centerY - cornerY;
+    float a = moveX * moveX + moveY * moveY;
+    float b = offsetX * moveX + offsetY * moveY;
+    float c = offsetX * offsetX + offsetY * offsetY - radius * radius;
+    float discriminant = b * b - a * c;
+    if (b >= 0 || discriminant < 0)
+    {
+        return 2;
+    }
+    float time = (-b - sqrtf(discriminant)) / a;
+    if (time > 1)
+    {
+        return 2;
+    }
+    *normalX = (offsetX + moveX * time) / radius;
+    *normalY = (offsetY + moveY * time) / radius;
+    return time;
+}
+
+
+//SHAPE CLASS
+class Shape
+{
+protected:
+    float positionX;
+    float positionY;
+
+public:
+    Shape(float posX, float posY) : positionX(posX), positionY(posY) {}
+
+    float getX()
+    {
+        return positionX;
+    }
+
+    float getY()
+    {
+        return positionY;
+    }
+};
+//RECTANGULARSHAPE CLASS
+class RectangularShape : public Shape
+{
+protected:
+    int width;
+    int height;
+
+public:
+    RectangularShape(float posX, float posY, int wid, int hei) : Shape(posX, posY), width(wid), height(hei) {}
+
+    int getWidth()
+    {
+        return width;
+    }
+
+    int getHeight()
+    {
+        return height;
+    }
+
+    bool checkCollision(float pointX, float pointY)
+    {
+        return pointX >= positionX && pointX < positionX + width &&
+               pointY >= positionY && pointY < positionY + height;
+    }
+};
+
+// PADDLE CLASS
+class Paddle : public RectangularShape
+{
+protected:
+    float velocityY;
+    float accelerationY;
+    int padding;
+    float previousY;
+
+    Paddle(float posX, float posY)
+        : RectangularShape(posX, posY - 50, 20, 100), velocityY(5 * FPS), accelerationY(0), padding(5), previousY(posY - 50)
+    {
+    }
+
+    void move(float direction, float dt)
+    {
+        positionY += direction * velocityY * dt;
+    }
+
+    void limitCheck()
+    {
+        if (positionY < padding)
+        {
+            positionY = padding;
+        }
+        else if (positionY + height > SCREEN_HEIGHT - padding)
+        {
+            positionY = SCREEN_HEIGHT - height - padding;
+        }
+    }
+
+public:
+    // Position for rendering, alpha of the way from the previous tick to this one.
+    float interpolateY(float alpha)
+    {
+        return previousY + (positionY - previousY) * alpha;
+    }
+
+    // Moves the paddle to y with nothing to interpolate from, as a netplay
+    // client does with its prediction whenever the server says where it is.
+    void place(float y)
+    {
+        positionY = y;
+        previousY = y;
+    }
+};
+// PLAYER CLASS
+class Player
+{
+private:
+    int score;
+    char name[20];
+
+public:
+    Player() : score(0)
+    {
+        name[0] = '\0';
+    }
+
+    void updateScore(int delta)
+    {
+        score += delta;
+    }
+
+    int getScore()
+    {
+        return score;
+    }
+
+    char *getName()
+    {
+        return name;
+    }
+
+    void setName(const char *newName)
+    {
+        strncpy(name, newName, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+    }
+};
+//BALL CLASS
+class Ball : public Shape
+{
+private:
+    float velocityX;
+    float velocityY;
+    float accelerationX;
+    float accelerationY;
+    float curveAcceleration;
+    float radius;
+    GameMode gameMode;
+    int round;
+    float previousX;
+    float previousY;
+    float dt;
+    int tickRate;
+    long ticks;
+    int bounces;
+    Platform *platform;
+    Profiler *profiler;
+
+    // The path kernels return a displacement per 1/FPS frame, so every
+    // tick scales them by dt * FPS. round counts those frames, not ticks;
+    // it comes from the integer tick count, so it neither drifts nor stalls
+    // however long a match runs.
+    // accelerationX/Y speed the ball up along its direction of travel, up to
+    // MAX_SPEED; choose() leaves them at zero, so only the curve path changes
+    // the speed. One instance per Path and Program, inlined
+    // into the update() of the same instance.
+    template <Path P, typename Kernels>
+    void pathStep(float *moveX, float *moveY)
+    {
+        ScopedTimer timer(profiler, PathZone);
+        float frames = dt * FPS;
+        velocityX += copysignf(accelerationX * dt, velocityX);
+        velocityY += copysignf(accelerationY * dt, velocityY) + curveAcceleration * dt;
+        velocityX = fminf(fmaxf(velocityX, -MAX_SPEED), MAX_SPEED);
+        velocityY = fminf(fmaxf(velocityY, -MAX_SPEED), MAX_SPEED);
+
+        float deltaX = Kernels::regularPath((int)velocityX);
+        float deltaY;
+        if constexpr (P == Path::Sin)
+        {
+            deltaY = Kernels::sinPath((int)velocityY, round);
+        }
+        else
+        {
+            if constexpr (P == Path::Curve)
+            {
+                curveAcceleration += Kernels::curvePath((int)positionX, (int)positionY) * frames;
+            }
+            deltaY = Kernels::regularPath((int)velocityY);
+        }
+
+        *moveX = deltaX * frames;
+        *moveY = deltaY * frames;
+        ticks++;
+        round = (int)(ticks * FPS / tickRate);
+    }
+
+    // Seconds since the start, alpha of the way into the last tick.
+    double elapsed(float alpha)
+    {
+        return (ticks - (1 - alpha)) / (double)tickRate;
+    }
+
+public:
+    Ball(GameMode gM, int rate, Platform *pl, Profiler *p)
+        : Shape(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2), velocityX(0), velocityY(0), accelerationX(0), accelerationY(0),
+          gameMode(gM), dt(1.0f / rate), tickRate(rate), bounces(0), platform(pl), profiler(p)
+    {
+        choose();
+        round = 0;
+        ticks = 0;
+        radius = 10;
+        reset();
+    }
+
+    Ball(int rate, Platform *pl, Profiler *p)
+        : Shape(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2), velocityX(300), velocityY(300), accelerationX(0), accelerationY(0),
+          curveAcceleration(0), dt(1.0f / rate), tickRate(rate), bounces(0), platform(pl), profiler(p)
+    {
+        int random = platform->randomValue(platform->context, 1, 3);
+        gameMode.path = (random == 1 ? Path::Regular : random == 2 ? Path::Sin
+                                                                : Path::Curve);
+        gameMode.difficulty = Difficulty::Easy;
+        gameMode.program = Program::Cpp;
+        round = 0;
+        ticks = 0;
+        radius = 10;
+        reset();
+    }
+
+    // Returns true when the ball bounced off a paddle on its way. P and
+    // Kernels must be the game mode's path and program; Simulation picks
+    // them once for the whole tick.
+    template <Path P, typename Kernels>
+    bool update(Player *player1, Player *player2, Paddle *leftPaddle, Paddle *rightPaddle)
+    {
+        previousX = positionX;
+        previousY = positionY;
+        float moveX;
+        float moveY;
+        pathStep<P, Kernels>(&moveX, &moveY);
+        bool hit = sweep(moveX, moveY, leftPaddle, rightPaddle, false);
+
+        if (positionX - radius <= 0)
+        {
+            player2->updateScore(1);
+            reset();
+        }
+        else if (positionX + radius >= SCREEN_WIDTH)
+        {
+            player1->updateScore(1);
+            reset();
+        }
+
+        if (conrner())
+        {
+            reset();
+            choose();
+        }
+        return hit;
+    }
+
+    // Bounces off all four walls, no paddles.
+    template <Path P, typename Kernels>
+    void update()
+    {
+        previousX = positionX;
+        previousY = positionY;
+        float moveX;
+        float moveY;
+        pathStep<P, Kernels>(&moveX, &moveY);
+        sweep(moveX, moveY, NULL, NULL, true);
+
+        if (conrner())
+        {
+            reset();
+            choose();
+        }
+    }
+
+    // Moves the ball by (moveX, moveY) for this tick, stopping at every
+    // impact with a wall or paddle on the way: the ball is put at the contact,
+    // its velocity and the rest of the move are reflected, and the sweep goes
+    // on from there, up to MAX_IMPACTS times. However far a tick moves the
+    // ball, it cannot tunnel. The paddles are where the last tick left them;
+    // one moving onto the ball is still caught by collision() afterwards.
+    // bounceSides makes the left and right edges walls instead of goals.
+    // Returns true when a paddle was hit.
+    bool sweep(float moveX, float moveY, Paddle *leftPaddle, Paddle *rightPaddle, bool bounceSides)
+    {
+        ScopedTimer timer(profiler, CollisionZone);
+        Paddle *paddles[2] = {leftPaddle, rightPaddle};
+        bool hit = false;
+
+        for (int impact = 0; impact < MAX_IMPACTS; impact++)
+        {
+            float first = 1;
+            float normalX = 0;
+            float normalY = 0;
+            bool paddleHit = false;
+
+            if (moveY < 0 && positionY + moveY - radius < 0)
+            {
+                first = clampf((radius - positionY) / moveY, 0, 1);
+                normalY = 1;
+            }
+            else if (moveY > 0 && positionY + moveY + radius > SCREEN_HEIGHT)
+            {
+                first = clampf((SCREEN_HEIGHT - radius - positionY) / moveY, 0, 1);
+                normalY = -1;
+            }
+            if (bounceSides && moveX < 0 && positionX + moveX - radius < 0)
+            {
+                float time = clampf((radius - positionX) / moveX, 0, 1);
+                if (time < first)
+                {
+                    first = time;
+                    normalX = 1;
+                    normalY = 0;
+                }
+            }
+            else if (bounceSides && moveX > 0 && positionX + moveX + radius > SCREEN_WIDTH)
+            {
+                float time = clampf((SCREEN_WIDTH - radius - positionX) / moveX, 0, 1);
+                if (time < first)
+                {
+                    first = time;
+                    normalX = -1;
+                    normalY = 0;
+                }
+            }
+
+            for (int i = 0; i < 2; i++)
+            {
+                if (!paddles[i])
+                {
+                    continue;
+                }
+                float contactNormalX;
+                float contactNormalY;
+                float time = sweepCircleRectangle(positionX, positionY, radius, moveX, moveY,
+                                                  paddles[i]->getX(), paddles[i]->getY(), paddles[i]->getWidth(),
+                                                  paddles[i]->getHeight(), &contactNormalX, &contactNormalY);
+
+                // Wherever it touches, a paddle sends the ball back horizontally,
+                // and only while it is heading into the paddle
+                float paddleCenterX = paddles[i]->getX() + paddles[i]->getWidth() / 2.0f;
+                float faceX = positionX + moveX * (time < first ? time : first) > paddleCenterX ? 1 : -1;
+                if (time <= first && velocityX * faceX < 0)
+                {
+                    first = time;
+                    normalX = faceX;
+                    normalY = 0;
+                    paddleHit = true;
+                }
+            }
+
+            positionX += moveX * first;
+            positionY += moveY * first;
+            if (normalX == 0 && normalY == 0)
+            {
+                break;
+            }
+            bounces++;
+
+            // The move says which way the ball goes: on the Sin path the sign
+            // of velocityY does not, so the velocity flips whenever the move
+            // went into the normal, which is always along one axis
+            float moveDot = moveX * normalX + moveY * normalY;
+            if (moveDot < 0)
+            {
+                velocityX = normalX != 0 ? -velocityX : velocityX;
+                velocityY = normalY != 0 ? -velocityY : velocityY;
+                moveX -= 2 * moveDot * normalX;
+                moveY -= 2 * moveDot * normalY;
+            }
+            moveX *= 1 - first;
+            moveY *= 1 - first;
+            hit |= paddleHit;
+        }
+        return hit;
+    }
+
+    // Returns true when the ball bounced off the paddle. Catches a paddle
+    // that moved onto the ball after sweep().
+    bool collision(Paddle *paddle)
+    {
+        ScopedTimer timer(profiler, CollisionZone);
+        if (circleRectangleOverlap(positionX, positionY, radius,
+                                   paddle->getX(), paddle->getY(), paddle->getWidth(), paddle->getHeight()))
+        {
+            // Only bounce while heading into the paddle, otherwise a ball that
+            // overlaps for several ticks keeps flipping back and forth.
+            float paddleCenterX = paddle->getX() + paddle->getWidth() / 2.0f;
+            if ((paddleCenterX - positionX) * velocityX > 0)
+            {
+                velocityX *= -1;
+                bounces++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void reset()
+    {
+        positionX = SCREEN_WIDTH / 2;
+        positionY = SCREEN_HEIGHT / 2;
+        previousX = positionX;
+        previousY = positionY;
+        bounces++;
+    }
+
+    void choose()
+    {
+        // The original integer acceleration / FPS rounded down to nothing, so
+        // the ball keeps its serve speed at every difficulty.
+        curveAcceleration = 0;
+        accelerationX = 0;
+        accelerationY = 0;
+        switch (gameMode.difficulty)
+        {
+        case Difficulty::Easy:
+            velocityX = 300;
+            velocityY = 300;
+            break;
+        case Difficulty::Meduim:
+            velocityX = 350;
+            velocityY = 350;
+            break;
+        case Difficulty::Hard:
+            velocityX = 400;
+            velocityY = 400;
+            break;
+        default:
+            break;
+        }
+
+        int random[2] = {-1, 1};
+        velocityX *= random[platform->randomValue(platform->context, 0, 1)];
+        velocityY *= random[platform->randomValue(platform->context, 0, 1)];
+    }
+
+    bool conrner()
+    {
+        return (positionX - radius <= 0 || positionX + radius >= SCREEN_WIDTH) &&
+            (positionY - radius <= 0 || positionY + radius >= SCREEN_HEIGHT);
+    }
+
+    float interpolateX(float alpha)
+    {
+        return previousX + (positionX - previousX) * alpha;
+    }
+
+    float interpolateY(float alpha)
+    {
+        return previousY + (positionY - previousY) * alpha;
+    }
+
+    // Pinwheel angle in the same units Ball::draw always used (0.1 rad per
+    // frame), within a turn so that it keeps its precision.
+    float rotationAngle(float alpha)
+    {
+        return (float)fmod(elapsed(alpha) * FPS * 0.1, 2 * PI);
+    }
+
+    float getRadius()
+    {
+        return radius;
+    }
+
+    // Counts every change of course that is not the path itself: walls,
+    // paddles and serves. A prediction holds until it changes.
+    int getBounces()
+    {
+        return bounces;
+    }
+
+    void trajectory(Trajectory *out)
+    {
+        // Only the Sin path reads the time, as a phase, so a whole number
+        // of its periods can go
+        float phase = (float)fmod(elapsed(1), 2 * PI / SIN_FREQUENCY);
+        *out = Trajectory{positionX, positionY, velocityX, velocityY, accelerationX, accelerationY,
+                          curveAcceleration, phase, radius, MAX_SPEED};
+    }
+
+    float getVelocityX()
+    {
+        return velocityX;
+    }
+
+    float getVelocityY()
+    {
+        return velocityY;
+    }
+
+    GameMode *getGameMode()
+    {
+        return &gameMode;
+    }
+};
+//BALL SYSTEM CLASS
+// The extra balls of chaos mode, kept as structure-of-arrays so thousands
+// of them go through the batch path kernels a BALL_BLOCK at a time. They
+// move like Ball::update() without players: they bounce off every wall, the
+// paddles, the obstacles and each other but never score. The arrays are
+// 64-byte aligned and padded to whole blocks, so every loop has a constant
+// trip count and the compiler vectorizes it even at -O2; the padding balls
+// move but are never drawn or collided. Contacts go through a SpatialGrid
+// rebuilt every tick, and each kind of pair is resolved in its own loop.
+class BallSystem
+{
+private:
+    int count;
+    int capacity;
+    float *x;
+    float *y;
+    float *vx;
+    float *vy;
+    float *ax;
+    float *ay;
+    float *curve;
+    float *previousX;
+    float *previousY;
+    int *phase;
+    int *round;
+    float radius;
+    float dt;
+    int tickRate;
+    long ticks;
+    int frame;
+    GameMode gameMode;
+    Platform *platform;
+    Profiler *profiler;
+    SpatialGrid grid;
+    Obstacle obstacles[MAX_OBSTACLES];
+    int obstacleCount;
+
+    template <typename T>
+    static T *allocate(int n)
+    {
+        return n > 0 ? (T *)aligned_alloc(64, n * sizeof(T)) : NULL;
+    }
+
+    // The block loops take restrict parameters, otherwise the arrays may
+    // alias and none of them vectorize.
+    static void accelerateBlock(float *__restrict vx, float *__restrict vy,
+                                const float *__restrict ax, const float *__restrict ay, const float *__restrict curve,
+                                int *__restrict velocityX, int *__restrict velocityY, float dt)
+    {
+        for (int k = 0; k < BALL_BLOCK; k++)
+        {
+            float velocity = clampf(vx[k] + copysignf(ax[k] * dt, vx[k]), -MAX_SPEED, MAX_SPEED);
+            vx[k] = velocity;
+            velocityX[k] = (int)velocity;
+            velocity = clampf(vy[k] + copysignf(ay[k] * dt, vy[k]) + curve[k] * dt, -MAX_SPEED, MAX_SPEED);
+            vy[k] = velocity;
+            velocityY[k] = (int)velocity;
+        }
+    }
+
+    // round is every ball's own phase plus the frame count shared by all.
+    static void moveBlock(float *__restrict x, float *__restrict y, int *__restrict round,
+                          const int *__restrict phase, const float *__restrict deltaX, const float *__restrict deltaY,
+                          float dt, int frame)
+    {
+        float frames = dt * FPS;
+        for (int k = 0; k < BALL_BLOCK; k++)
+        {
+            x[k] += deltaX[k] * frames;
+            y[k] += deltaY[k] * frames;
+            round[k] = phase[k] + frame;
+        }
+    }
+
+    // Returns whether any ball of the block ended up in a corner.
+    static bool bounceBlock(float *__restrict x, float *__restrict y, float *__restrict vx, float *__restrict vy,
+                            float radius)
+    {
+        float minX = radius;
+        float maxX = SCREEN_WIDTH - radius;
+        float minY = radius;
+        float maxY = SCREEN_HEIGHT - radius;
+        int corners = 0;
+
+        for (int k = 0; k < BALL_BLOCK; k++)
+        {
+            int hitX = (x[k] <= minX) | (x[k] >= maxX);
+            int hitY = (y[k] <= minY) | (y[k] >= maxY);
+            vx[k] = hitX ? -vx[k] : vx[k];
+            vy[k] = hitY ? -vy[k] : vy[k];
+            x[k] = clampf(x[k], minX, maxX);
+            y[k] = clampf(y[k], minY, maxY);
+            corners |= hitX & hitY;
+        }
+        return corners;
+    }
+
+    // Narrowphase filter for n candidate pairs of slots a[k], b[k]: whether
+    // the two balls were touching when the grid was built.
+    static void touchBlock(const float *__restrict sortedX, const float *__restrict sortedY,
+                           const int *__restrict a, const int *__restrict b, int n, float diameter,
+                           unsigned char *__restrict touching)
+    {
+        float diameterSquared = diameter * diameter;
+        for (int k = 0; k < n; k++)
+        {
+            float distanceX = sortedX[b[k]] - sortedX[a[k]];
+            float distanceY = sortedY[b[k]] - sortedY[a[k]];
+            touching[k] = distanceX * distanceX + distanceY * distanceY < diameterSquared;
+        }
+    }
+
+    // Equal masses: the balls swap their velocities along the line between
+    // their centers if they are closing in, and are pushed apart.
+    bool bounceBalls(int i, int j)
+    {
+        float distanceX = x[j] - x[i];
+        float distanceY = y[j] - y[i];
+        float distanceSquared = distanceX * distanceX + distanceY * distanceY;
+        float diameter = 2 * radius;
+        if (distanceSquared >= diameter * diameter || distanceSquared == 0)
+        {
+            return false;
+        }
+
+        float distance = sqrtf(distanceSquared);
+        float normalX = distanceX / distance;
+        float normalY = distanceY / distance;
+        float closing = (vx[j] - vx[i]) * normalX + (vy[j] - vy[i]) * normalY;
+        if (closing < 0)
+        {
+            vx[i] += closing * normalX;
+            vy[i] += closing * normalY;
+            vx[j] -= closing * normalX;
+            vy[j] -= closing * normalY;
+        }
+        float push = (diameter - distance) / 2;
+        x[i] -= normalX * push;
+        y[i] -= normalY * push;
+        x[j] += normalX * push;
+        y[j] += normalY * push;
+        return true;
+    }
+
+    // Ball against ball over the grid's candidate pairs; returns the contacts.
+    int collideBalls()
+    {
+        int pairs = grid.findPairs(2 * radius);
+        const int *a = grid.getPairA();
+        const int *b = grid.getPairB();
+        const int *body = grid.getEntries();
+        unsigned char touching[BALL_BLOCK];
+        int contacts = 0;
+
+        for (int first = 0; first < pairs; first += BALL_BLOCK)
+        {
+            int n = pairs - first < BALL_BLOCK ? pairs - first : BALL_BLOCK;
+            touchBlock(grid.getSortedX(), grid.getSortedY(), a + first, b + first, n, 2 * radius, touching);
+            for (int k = 0; k < n; k++)
+            {
+                if (touching[k])
+                {
+                    contacts += bounceBalls(body[a[first + k]], body[b[first + k]]);
+                }
+            }
+        }
+        return contacts;
+    }
+
+    // Ball against obstacle: reflected if heading in, pushed out to touching.
+    int collideObstacles()
+    {
+        int contacts = 0;
+        const int *body = grid.getEntries();
+
+        for (int o = 0; o < obstacleCount; o++)
+        {
+            Obstacle *obstacle = &obstacles[o];
+            float reach = 2 * radius;
+            int pairs = grid.findOverlaps(obstacle->x - reach, obstacle->y - reach,
+                                          obstacle->x + obstacle->width + reach, obstacle->y + obstacle->height + reach,
+                                          o, true);
+            const int *slot = grid.getPairA();
+            for (int p = 0; p < pairs; p++)
+            {
+                int i = body[slot[p]];
+                float normalX;
+                float normalY;
+                float distance = contactNormal(x[i], y[i], obstacle->x, obstacle->y, obstacle->width, obstacle->height,
+                                               &normalX, &normalY);
+                if (distance > radius)
+                {
+                    continue;
+                }
+                float heading = vx[i] * normalX + vy[i] * normalY;
+                if (heading < 0)
+                {
+                    vx[i] -= 2 * heading * normalX;
+                    vy[i] -= 2 * heading * normalY;
+                }
+                x[i] += normalX * (radius - distance);
+                y[i] += normalY * (radius - distance);
+                contacts++;
+            }
+        }
+        return contacts;
+    }
+
+    // Scatters ball i over the court with the difficulty's speed, like Ball::choose().
+    void spawn(int i)
+    {
+        float speed;
+        switch (gameMode.difficulty)
+        {
+        case Difficulty::Meduim:
+            speed = 350;
+            break;
+        case Difficulty::Hard:
+            speed = 400;
+            break;
+        default:
+            speed = 300;
+            break;
+        }
+
+        int random[2] = {-1, 1};
+        x[i] = platform->randomValue(platform->context, (int)radius + 1, SCREEN_WIDTH - (int)radius - 1);
+        y[i] = platform->randomValue(platform->context, (int)radius + 1, SCREEN_HEIGHT - (int)radius - 1);
+        vx[i] = speed * random[platform->randomValue(platform->context, 0, 1)];
+        vy[i] = speed * platform->randomValue(platform->context, 25, 100) / 100 * random[platform->randomValue(platform->context, 0, 1)];
+        ax[i] = 0;
+        ay[i] = 0;
+        curve[i] = 0;
+        previousX[i] = x[i];
+        previousY[i] = y[i];
+        // A random phase so the sin path balls do not all swing together
+        phase[i] = platform->randomValue(platform->context, 0, 1000) - frame;
+        round[i] = phase[i] + frame;
+    }
+
+    // Ball::pathStep() for the block starting at ball first.
+    template <Path P, typename Kernels>
+    void path(int first)
+    {
+        int velocityX[BALL_BLOCK];
+        int velocityY[BALL_BLOCK];
+        float deltaX[BALL_BLOCK];
+        float deltaY[BALL_BLOCK];
+
+        accelerateBlock(vx + first, vy + first, ax + first, ay + first, curve + first, velocityX, velocityY, dt);
+
+        Kernels::regularPathBatch(velocityX, deltaX, BALL_BLOCK);
+        if constexpr (P == Path::Sin)
+        {
+            Kernels::sinPathBatch(velocityY, round + first, deltaY, BALL_BLOCK);
+        }
+        else
+        {
+            if constexpr (P == Path::Curve)
+            {
+                int positionX[BALL_BLOCK];
+                int positionY[BALL_BLOCK];
+                float curveDelta[BALL_BLOCK];
+                for (int k = 0; k < BALL_BLOCK; k++)
+                {
+                    positionX[k] = (int)x[first + k];
+                    positionY[k] = (int)y[first + k];
+                }
+                Kernels::curvePathBatch(positionX, positionY, curveDelta, BALL_BLOCK);
+                for (int k = 0; k < BALL_BLOCK; k++)
+                {
+                    curve[first + k] += curveDelta[k] * dt * FPS;
+                }
+            }
+            Kernels::regularPathBatch(velocityY, deltaY, BALL_BLOCK);
+        }
+
+        moveBlock(x + first, y + first, round + first, phase + first, deltaX, deltaY, dt, frame);
+    }
+
+    // Moves every block and bounces it off the walls. One instance per Path
+    // and Program.
+    template <Path P, typename Kernels>
+    void moveBlocks()
+    {
+        memcpy(previousX, x, capacity * sizeof(float));
+        memcpy(previousY, y, capacity * sizeof(float));
+        ticks++;
+        frame = (int)(ticks * FPS / tickRate);
+
+        for (int first = 0; first < capacity; first += BALL_BLOCK)
+        {
+            path<P, Kernels>(first);
+            if (bounceBlock(x + first, y + first, vx + first, vy + first, radius))
+            {
+                // Rare, so the corner check is redone per ball only here
+                for (int i = first; i < first + BALL_BLOCK; i++)
+                {
+                    if ((x[i] <= radius || x[i] >= SCREEN_WIDTH - radius) &&
+                        (y[i] <= radius || y[i] >= SCREEN_HEIGHT - radius))
+                    {
+                        spawn(i);
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    BallSystem(int numberOfBalls, GameMode gM, int rate, Platform *pl, Profiler *p)
+        : count(numberOfBalls > 0 ? numberOfBalls : 0), radius(10), dt(1.0f / rate), tickRate(rate), ticks(0), frame(0),
+          gameMode(gM), platform(pl), profiler(p), obstacleCount(0)
+    {
+        // Without chaos balls nothing is allocated or spawned, so a normal
+        // game draws nothing from the platform's random numbers here
+        capacity = (count + BALL_BLOCK - 1) / BALL_BLOCK * BALL_BLOCK;
+        x = allocate<float>(capacity);
+        y = allocate<float>(capacity);
+        vx = allocate<float>(capacity);
+        vy = allocate<float>(capacity);
+        ax = allocate<float>(capacity);
+        ay = allocate<float>(capacity);
+        curve = allocate<float>(capacity);
+        previousX = allocate<float>(capacity);
+        previousY = allocate<float>(capacity);
+        phase = allocate<int>(capacity);
+        round = allocate<int>(capacity);
+        for (int i = 0; i < capacity; i++)
+        {
+            spawn(i);
+        }
+    }
+
+    BallSystem(const BallSystem &) = delete;
+    BallSystem &operator=(const BallSystem &) = delete;
+
+    ~BallSystem()
+    {
+        free(x);
+        free(y);
+        free(vx);
+        free(vy);
+        free(ax);
+        free(ay);
+        free(curve);
+        free(previousX);
+        free(previousY);
+        free(phase);
+        free(round);
+    }
+
+    // P and Kernels as for Ball::update().
+    template <Path P, typename Kernels>
+    void update()
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        {
+            ScopedTimer timer(profiler, PathZone);
+            moveBlocks<P, Kernels>();
+        }
+
+        ScopedTimer timer(profiler, CollisionZone);
+        grid.build(x, y, count);
+        collideBalls();
+        collideObstacles();
+    }
+
+    // Ball::collision() for every ball the grid has near the paddle; returns
+    // how many bounced off it. Call it after update().
+    int collision(Paddle *paddle)
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        ScopedTimer timer(profiler, CollisionZone);
+        float left = paddle->getX();
+        float top = paddle->getY();
+        float right = left + paddle->getWidth();
+        float bottom = top + paddle->getHeight();
+        float centerX = (left + right) / 2;
+        // Balls pushed apart since the grid was built moved by up to a radius
+        float reach = 2 * radius;
+        int pairs = grid.findOverlaps(left - reach, top - reach, right + reach, bottom + reach, 0, true);
+        const int *slot = grid.getPairA();
+        const int *body = grid.getEntries();
+        int hits = 0;
+
+        for (int p = 0; p < pairs; p++)
+        {
+            int i = body[slot[p]];
+            if (circleRectangleOverlap(x[i], y[i], radius, left, top, right - left, bottom - top) &&
+                (centerX - x[i]) * vx[i] > 0)
+            {
+                vx[i] = -vx[i];
+                hits++;
+            }
+        }
+        return hits;
+    }
+
+    // Obstacles only stop the chaos balls; false once MAX_OBSTACLES are in.
+    bool addObstacle(float obstacleX, float obstacleY, float width, float height)
+    {
+        if (obstacleCount == MAX_OBSTACLES)
+        {
+            return false;
+        }
+        obstacles[obstacleCount++] = Obstacle{obstacleX, obstacleY, width, height};
+        return true;
+    }
+
+    int getObstacleCount()
+    {
+        return obstacleCount;
+    }
+
+    Obstacle *getObstacle(int i)
+    {
+        return &obstacles[i];
+    }
+
+    int getCount()
+    {
+        return count;
+    }
+
+    float getRadius()
+    {
+        return radius;
+    }
+
+    float getX(int i)
+    {
+        return x[i];
+    }
+
+    float getY(int i)
+    {
+        return y[i];
+    }
+
+    float interpolateX(int i, float alpha)
+    {
+        return previousX[i] + (x[i] - previousX[i]) * alpha;
+    }
+
+    float interpolateY(int i, float alpha)
+    {
+        return previousY[i] + (y[i] - previousY[i]) * alpha;
+    }
+
+    float rotationAngle(int i, float alpha)
+    {
+        return (float)fmod((phase[i] + (ticks - (1 - alpha)) * FPS / (double)tickRate) * 0.1, 2 * PI);
+    }
+
+    GameMode *getGameMode()
+    {
+        return &gameMode;
+    }
+};
+//CLASS RUGHT PADDLE
+// With isAI it plays by the Difficulty's AiModel: once the ball comes its
+// way it predicts where the ball will arrive, misjudges that by a random
+// error and heads there after its reaction time. The prediction is made
+// again only when the ball bounces, see predictor.h.
+class RightPaddle : public Paddle
+{
+private:
+    bool isAI;
+    AiModel model;
+    Platform *platform;
+    int seenBounces;
+    bool tracking;
+    float error;
+    float reactionLeft;
+    float predictedY;
+    float targetY;
+
+    void aim(Ball *ball, float dt)
+    {
+        bool coming = ball->getVelocityX() > 0 && ball->getX() > SCREEN_WIDTH * model.vision;
+        if (coming != tracking)
+        {
+            tracking = coming;
+            seenBounces = -1;
+            reactionLeft = model.reaction;
+            error = coming ? platform->randomValue(platform->context, -model.error, model.error) : 0;
+        }
+
+        if (!tracking)
+        {
+            predictedY = model.recenter ? SCREEN_HEIGHT / 2 : positionY + height / 2;
+        }
+        else if (ball->getBounces() != seenBounces)
+        {
+            seenBounces = ball->getBounces();
+            Trajectory trajectory;
+            ball->trajectory(&trajectory);
+            float time;
+            predictedY = predictIntercept(&trajectory, positionX - trajectory.radius, ball->getGameMode(), &time) + error;
+        }
+
+        reactionLeft -= dt;
+        if (reactionLeft <= 0)
+        {
+            targetY = predictedY;
+        }
+    }
+
+public:
+
+    RightPaddle(float posX, float posY, bool AI, Difficulty difficulty, Platform *pl)
+        : Paddle(posX, posY), isAI(AI), model(aiModel(difficulty)), platform(pl), seenBounces(-1),
+          tracking(false), error(0), reactionLeft(0), predictedY(posY), targetY(posY)
+    {
+        positionX -= padding;
+        positionX -= width;
+    }
+
+    void update(Ball *ball, unsigned input, float dt)
+    {
+        previousY = positionY;
+        if (isAI)
+        {
+            aim(ball, dt);
+            float center = positionY + height / 2;
+            float step = model.speed * velocityY * dt;
+            float distance = targetY - center;
+            // Never step past the target, or the paddle jitters around it at high tick rates
+            if (distance < -step)
+            {
+                positionY -= step;
+            }
+            else if (distance > step)
+            {
+                positionY += step;
+            }
+            else
+            {
+                positionY += distance;
+            }
+        }
+        else
+        {
+            if (input & InputUp)
+            {
+                move(-1, dt);
+            }
+            else if (input & InputDown)
+            {
+                move(1, dt);
+            }
+        }
+        limitCheck();
+    }
+};
+//CLASS LEFT PADDLE
+class LeftPaddle : public Paddle
+{
+public:
+    LeftPaddle(float posX, float posY)
+        : Paddle(posX, posY)
+    {
+        positionX += padding;
+    }
+
+    void update(unsigned input, float dt)
+    {
+        previousY = positionY;
+        if (input & InputW)
+        {
+            move(-1, dt);
+        }
+        else if (input & InputS)
+        {
+            move(1, dt);
+        }
+        limitCheck();
+    }
+};
+
+//SIMULATION CLASS
+// Fixed-timestep driver: advance() eats real frame time through an
+// accumulator and runs as many fixed ticks as fit; alpha() is what is left
+// over, for interpolating the render between the last two ticks.
+class Simulation
+{
+private:
+    float dt;
+    float accumulator;
+    long tick;
+    Player *player1;
+    Player *player2;
+    Ball ball;
+    BallSystem balls;
+    LeftPaddle leftPaddle;
+    RightPaddle rightPaddle;
+
+    typedef unsigned (Simulation::*TickStep)(unsigned input);
+    TickStep tickStep;
+
+    // One instance per Path and Program, so the ball's path kernels and
+    // everything around them inline into a single loop body with the path
+    // and program as constants.
+    template <Path P, typename Kernels>
+    unsigned tickAs(unsigned input)
+    {
+        int score = player1->getScore() + player2->getScore();
+        unsigned events = 0;
+
+        bool hit = ball.update<P, Kernels>(player1, player2, &leftPaddle, &rightPaddle);
+        balls.update<P, Kernels>();
+        leftPaddle.update(input, dt);
+        rightPaddle.update(&ball, input, dt);
+        if (hit | ball.collision(&leftPaddle) | ball.collision(&rightPaddle))
+        {
+            events |= EventHit;
+        }
+        balls.collision(&leftPaddle);
+        balls.collision(&rightPaddle);
+        if (player1->getScore() + player2->getScore() != score)
+        {
+            events |= EventPoint;
+        }
+        tick++;
+        return events;
+    }
+
+    template <typename Kernels>
+    static TickStep tickStepFor(Path path)
+    {
+        switch (path)
+        {
+        case Path::Sin:
+            return &Simulation::tickAs<Path::Sin, Kernels>;
+        case Path::Curve:
+            return &Simulation::tickAs<Path::Curve, Kernels>;
+        default:
+            return &Simulation::tickAs<Path::Regular, Kernels>;
+        }
+    }
+
+public:
+    // chaosBalls extra balls bounce around next to the real one; 0 for a normal game.
+    Simulation(GameMode *gameMode, Player *p1, Player *p2, int tickRate, int chaosBalls, Platform *platform, Profiler *profiler)
+        : dt(1.0f / tickRate), accumulator(0), tick(0), player1(p1), player2(p2),
+          ball(*gameMode, tickRate, platform, profiler),
+          balls(chaosBalls, *gameMode, tickRate, platform, profiler),
+          leftPaddle(0, SCREEN_HEIGHT / 2),
+          rightPaddle(SCREEN_WIDTH, SCREEN_HEIGHT / 2, gameMode->numberOfPlayer == 1, gameMode->difficulty, platform)
+    {
+        // The only place the path and program are looked at
+        tickStep = gameMode->program == Program::Cpp ? tickStepFor<CppKernels>(gameMode->path)
+                                                     : tickStepFor<AssemblyKernels>(gameMode->path);
+    }
+
+    // One fixed tick; returns the Event bits of what happened in it.
+    unsigned step(unsigned input)
+    {
+        return (this->*tickStep)(input);
+    }
+
+    // Returns the number of ticks run for this frame.
+    int advance(float frameTime, unsigned input)
+    {
+        if (frameTime > MAX_FRAME_TIME)
+        {
+            frameTime = MAX_FRAME_TIME;
+        }
+        accumulator += frameTime;
+
+        int steps = 0;
+        while (accumulator >= dt)
+        {
+            step(input);
+            accumulator -= dt;
+            steps++;
+        }
+        return steps;
+    }
+
+    float alpha()
+    {
+        return accumulator / dt;
+    }
+
+    float getDt()
+    {
+        return dt;
+    }
+
+    long getTick()
+    {
+        return tick;
+    }
+
+    Ball *getBall()
+    {
+        return &ball;
+    }
+
+    BallSystem *getBalls()
+    {
+        return &balls;
+    }
+
+    // Only the chaos balls bounce off obstacles; see BallSystem::addObstacle().
+    bool addObstacle(float x, float y, float width, float height)
+    {
+        return balls.addObstacle(x, y, width, height);
+    }
+
+    LeftPaddle *getLeftPaddle()
+    {
+        return &leftPaddle;
+    }
+
+    RightPaddle *getRightPaddle()
+    {
+        return &rightPaddle;
+    }
+};
+
+#endif
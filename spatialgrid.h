@@ -0,0 +1,236 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "kernels.h"
+
+// Uniform grid broadphase over the court. build() counting-sorts the bodies
+// by cell in O(n): one pass counts, a prefix sum gives every cell its slice
+// of entries, a second pass scatters the body indices into it. A cell's
+// bodies are then contiguous, and so are their positions, which build()
+// copies in the same order. Cells are GRID_CELL wide, a ball's diameter, so
+// two touching balls are in the same or neighbouring cells, and every
+// neighbouring pair of cells is visited once by looking only right and
+// down. The broadphase lists the pairs whose bounding squares overlap, as
+// slots into the cell order; the caller's narrowphase tests them exactly
+// and maps the ones that touch to bodies through getEntries().
+
+#define GRID_CELL 20
+#define GRID_COLUMNS ((SCREEN_WIDTH + GRID_CELL - 1) / GRID_CELL)
+#define GRID_ROWS ((SCREEN_HEIGHT + GRID_CELL - 1) / GRID_CELL)
+#define GRID_CELLS (GRID_COLUMNS * GRID_ROWS)
+
+//SPATIAL GRID CLASS
+class SpatialGrid
+{
+private:
+    int start[GRID_CELLS + 1];
+    int *cellOf;
+    int *entries;
+    float *sortedX;
+    float *sortedY;
+    int count;
+    int capacity;
+
+    int *pairA;
+    int *pairB;
+    int pairs;
+    int pairCapacity;
+
+    static int column(float x)
+    {
+        int c = (int)(x * (1.0f / GRID_CELL));
+        return c < 0 ? 0 : c >= GRID_COLUMNS ? GRID_COLUMNS - 1 : c;
+    }
+
+    static int row(float y)
+    {
+        int r = (int)(y * (1.0f / GRID_CELL));
+        return r < 0 ? 0 : r >= GRID_ROWS ? GRID_ROWS - 1 : r;
+    }
+
+    // Makes room for extra more pairs.
+    void reserve(int extra)
+    {
+        if (pairs + extra > pairCapacity)
+        {
+            while (pairs + extra > pairCapacity)
+            {
+                pairCapacity = pairCapacity ? pairCapacity * 2 : 1024;
+            }
+            pairA = (int *)realloc(pairA, pairCapacity * sizeof(int));
+            pairB = (int *)realloc(pairB, pairCapacity * sizeof(int));
+        }
+    }
+
+    // Pairs of slot i with slots first..last-1 closer than reach on both
+    // axes. Every candidate is written and only the close ones are kept, so
+    // there is no branch to mispredict.
+    void closePairs(int i, int first, int last, float reach)
+    {
+        reserve(last - first);
+        float pointX = sortedX[i];
+        float pointY = sortedY[i];
+        int n = pairs;
+        for (int j = first; j < last; j++)
+        {
+            pairA[n] = i;
+            pairB[n] = j;
+            n += (fabsf(sortedX[j] - pointX) < reach) & (fabsf(sortedY[j] - pointY) < reach);
+        }
+        pairs = n;
+    }
+
+public:
+    SpatialGrid()
+        : cellOf(NULL), entries(NULL), sortedX(NULL), sortedY(NULL), count(0), capacity(0),
+          pairA(NULL), pairB(NULL), pairs(0), pairCapacity(0)
+    {
+        memset(start, 0, sizeof(start));
+    }
+
+    SpatialGrid(const SpatialGrid &) = delete;
+    SpatialGrid &operator=(const SpatialGrid &) = delete;
+
+    ~SpatialGrid()
+    {
+        free(cellOf);
+        free(entries);
+        free(sortedX);
+        free(sortedY);
+        free(pairA);
+        free(pairB);
+    }
+
+    // Bins bodies 0..n-1 at (x[i], y[i]); positions off the court go to the edge cells.
+    void build(const float *x, const float *y, int n)
+    {
+        if (n > capacity)
+        {
+            capacity = n;
+            cellOf = (int *)realloc(cellOf, capacity * sizeof(int));
+            entries = (int *)realloc(entries, capacity * sizeof(int));
+            sortedX = (float *)realloc(sortedX, capacity * sizeof(float));
+            sortedY = (float *)realloc(sortedY, capacity * sizeof(float));
+        }
+        count = n;
+
+        memset(start, 0, sizeof(start));
+        for (int i = 0; i < n; i++)
+        {
+            cellOf[i] = row(y[i]) * GRID_COLUMNS + column(x[i]);
+            start[cellOf[i] + 1]++;
+        }
+        for (int c = 0; c < GRID_CELLS; c++)
+        {
+            start[c + 1] += start[c];
+        }
+
+        // start[c] is used as the fill cursor of cell c, which leaves it at
+        // the start of cell c + 1; shifting back afterwards restores it.
+        for (int i = 0; i < n; i++)
+        {
+            int slot = start[cellOf[i]]++;
+            entries[slot] = i;
+            sortedX[slot] = x[i];
+            sortedY[slot] = y[i];
+        }
+        memmove(start + 1, start, GRID_CELLS * sizeof(int));
+        start[0] = 0;
+    }
+
+    // Lists every pair of slots in the same or neighbouring cells that are
+    // closer than reach on both axes, each once; reach is at most GRID_CELL.
+    int findPairs(float reach)
+    {
+        pairs = 0;
+        for (int r = 0; r < GRID_ROWS; r++)
+        {
+            for (int c = 0; c < GRID_COLUMNS; c++)
+            {
+                int cell = r * GRID_COLUMNS + c;
+                if (start[cell] == start[cell + 1])
+                {
+                    continue;
+                }
+                // The right neighbour, then the three below, which are one contiguous run
+                int right = c + 1 < GRID_COLUMNS ? cell + 1 : cell;
+                int belowFirst = r + 1 < GRID_ROWS ? cell + GRID_COLUMNS - (c > 0) : cell;
+                int belowLast = r + 1 < GRID_ROWS ? cell + GRID_COLUMNS + (c + 1 < GRID_COLUMNS) : cell - 1;
+                for (int i = start[cell]; i < start[cell + 1]; i++)
+                {
+                    closePairs(i, i + 1, start[right + 1], reach);
+                    closePairs(i, start[belowFirst], start[belowLast + 1], reach);
+                }
+            }
+        }
+        return pairs;
+    }
+
+    // Lists (slot, id) for every body in the cells the rectangle covers; the
+    // caller grows the rectangle by the body radius. Appends to the pairs
+    // unless first is true.
+    int findOverlaps(float left, float top, float right, float bottom, int id, bool first)
+    {
+        if (first)
+        {
+            pairs = 0;
+        }
+        int firstColumn = column(left);
+        int lastColumn = column(right);
+        for (int r = row(top); r <= row(bottom); r++)
+        {
+            int begin = start[r * GRID_COLUMNS + firstColumn];
+            int end = start[r * GRID_COLUMNS + lastColumn + 1];
+            // The covered cells of a row are one contiguous run of entries
+            reserve(end - begin);
+            for (int i = begin; i < end; i++)
+            {
+                pairA[pairs] = i;
+                pairB[pairs] = id;
+                pairs++;
+            }
+        }
+        return pairs;
+    }
+
+    const int *getPairA()
+    {
+        return pairA;
+    }
+
+    const int *getPairB()
+    {
+        return pairB;
+    }
+
+    int getPairs()
+    {
+        return pairs;
+    }
+
+    int getCount()
+    {
+        return count;
+    }
+
+    // The body in every slot, and its position at build() time.
+    const int *getEntries()
+    {
+        return entries;
+    }
+
+    const float *getSortedX()
+    {
+        return sortedX;
+    }
+
+    const float *getSortedY()
+    {
+        return sortedY;
+    }
+};
+
+#endif
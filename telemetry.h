@@ -0,0 +1,327 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "kernels.h"
+#include "profiler.h"
+
+// Session and per-frame records as JSON lines, one object per line, so runs
+// can be loaded straight into a plotting tool. The render loop only copies
+// a FrameRecord into a fixed ring; a background thread formats and writes
+// them. The ring never grows: when the writer falls TELEMETRY_CAPACITY
+// frames behind, new frames are dropped and counted instead of stalling the
+// frame. flush() blocks until everything recorded so far is on disk.
+// Frames that show a new input also carry its latency: from sampling to the
+// first tick that used it, and to the end of the frame that presented it.
+//
+//     {"type": "session", "event": "start", "session": 42, "program": "assembly", ...}
+//     {"type": "frame", "session": 42, "frame": 1, "frame_ns": 16667120, "ticks": 17, ...}
+//     {"type": "schedule", "session": 42, "scene": "menu", "duty_cycle": 0.0004, ...}
+//     {"type": "net", "session": 42, "role": "server", "sent_bytes_per_tick": 61.0, ...}
+//     {"type": "session", "event": "end", "session": 42, "frames": 1200, "dropped": 0, ...}
+
+#define TELEMETRY_CAPACITY 4096
+#define TELEMETRY_BUFFER (64 * 1024)
+
+//STRUCTURS
+struct ScheduleReport;
+struct NetReport;
+
+typedef struct FrameRecord
+{
+    uint64_t frame;
+    uint64_t frameTime;
+    uint64_t zones[NumberOfZones];
+    int ticks;
+    int balls;
+    uint64_t tickLatency;
+    uint64_t presentLatency;
+} FrameRecord;
+
+// Nanoseconds from sampling an input to its first tick and to its first
+// presented frame; 0 when the frame shows no new input.
+typedef struct Latency
+{
+    uint64_t tick;
+    uint64_t present;
+} Latency;
+
+typedef struct Session
+{
+    unsigned long long id;
+    GameMode gameMode;
+    int tickRate;
+    int chaosBalls;
+} Session;
+
+inline const char *pathName(Path path)
+{
+    return path == Path::Sin ? "sin" : path == Path::Curve ? "curve" : "regular";
+}
+
+inline const char *difficultyName(Difficulty difficulty)
+{
+    return difficulty == Difficulty::Meduim ? "medium" : difficulty == Difficulty::Hard ? "hard" : "easy";
+}
+
+inline const char *programName(Program program)
+{
+    return program == Program::Assembly ? "assembly" : "cpp";
+}
+
+//TELEMETRY CLASS
+class Telemetry
+{
+private:
+    FILE *file;
+    Session session;
+    FrameRecord records[TELEMETRY_CAPACITY];
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+    uint64_t frames;
+    Histogram tickLatency;
+    Histogram presentLatency;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    bool running;
+    bool drainRequested;
+    uint64_t flushRequests;
+    uint64_t flushesDone;
+
+    // Holds the stream's lock for the whole line, which takes several
+    // calls, so a record written from another thread cannot land inside it.
+    void writeFrame(const FrameRecord *record)
+    {
+        flockfile(file);
+        fprintf(file,
+                "{\"type\": \"frame\", \"session\": %llu, \"program\": \"%s\", \"path\": \"%s\", "
+                "\"frame\": %llu, \"frame_ns\": %llu, \"ticks\": %d, \"balls\": %d",
+                session.id, programName(session.gameMode.program), pathName(session.gameMode.path),
+                (unsigned long long)record->frame, (unsigned long long)record->frameTime, record->ticks, record->balls);
+        for (int i = 0; i < NumberOfZones; i++)
+        {
+            fprintf(file, ", \"%s_ns\": %llu", zoneName((Zone)i), (unsigned long long)record->zones[i]);
+        }
+        if (record->presentLatency)
+        {
+            fprintf(file, ", \"tick_latency_ns\": %llu, \"present_latency_ns\": %llu",
+                    (unsigned long long)record->tickLatency, (unsigned long long)record->presentLatency);
+        }
+        fputs("}\n", file);
+        funlockfile(file);
+    }
+
+    // Writer thread: wakes every 100 ms, or early for a flush, a half full
+    // ring or close(), and writes out whatever the render loop has queued.
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait_for(lock, std::chrono::milliseconds(100),
+                          [this]() { return !running || drainRequested || flushRequests != flushesDone; });
+            drainRequested = false;
+            bool stop = !running;
+            uint64_t requests = flushRequests;
+            lock.unlock();
+
+            uint64_t last = tail.load(std::memory_order_relaxed);
+            uint64_t first = head.load(std::memory_order_acquire);
+            for (; last != first; last++)
+            {
+                writeFrame(&records[last % TELEMETRY_CAPACITY]);
+            }
+            tail.store(last, std::memory_order_release);
+            if (stop || requests != flushesDone)
+            {
+                fflush(file);
+            }
+
+            lock.lock();
+            if (requests != flushesDone)
+            {
+                flushesDone = requests;
+                flushed.notify_all();
+            }
+            if (stop)
+            {
+                return;
+            }
+        }
+    }
+
+public:
+    Telemetry()
+        : file(NULL), head(0), tail(0), dropped(0), frames(0), running(false), drainRequested(false),
+          flushRequests(0), flushesDone(0)
+    {
+    }
+
+    Telemetry(const Telemetry &) = delete;
+    Telemetry &operator=(const Telemetry &) = delete;
+
+    ~Telemetry()
+    {
+        close(NULL, 0);
+    }
+
+    // Appends to path, so one file collects every session.
+    bool open(const char *path, Session *newSession)
+    {
+        file = fopen(path, "a");
+        if (!file)
+        {
+            return false;
+        }
+        setvbuf(file, NULL, _IOFBF, TELEMETRY_BUFFER);
+
+        session = *newSession;
+        head.store(0);
+        tail.store(0);
+        dropped.store(0);
+        frames = 0;
+        drainRequested = false;
+        tickLatency.reset();
+        presentLatency.reset();
+        fprintf(file,
+                "{\"type\": \"session\", \"event\": \"start\", \"session\": %llu, \"program\": \"%s\", \"path\": \"%s\", "
+                "\"difficulty\": \"%s\", \"players\": %d, \"tick_rate\": %d, \"chaos_balls\": %d, \"isa\": \"%s\"}\n",
+                session.id, programName(session.gameMode.program), pathName(session.gameMode.path),
+                difficultyName(session.gameMode.difficulty), session.gameMode.numberOfPlayer,
+                session.tickRate, session.chaosBalls, isaName(asmKernels.isa));
+
+        running = true;
+        writer = std::thread(&Telemetry::run, this);
+        return true;
+    }
+
+    // Called by the render loop right after profiler->endFrame(). Only waits
+    // for the writer's mutex, which is never held while writing, when the
+    // ring gets half full and the writer is woken to drain it.
+    void frame(const Profiler *profiler, int ticks, int balls, const Latency *latency)
+    {
+        if (!file)
+        {
+            return;
+        }
+        frames++;
+        if (latency->present)
+        {
+            tickLatency.record(latency->tick);
+            presentLatency.record(latency->present);
+        }
+
+        uint64_t next = head.load(std::memory_order_relaxed);
+        uint64_t queued = next - tail.load(std::memory_order_acquire);
+        if (queued >= TELEMETRY_CAPACITY)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        FrameRecord *record = &records[next % TELEMETRY_CAPACITY];
+        record->frame = frames;
+        record->frameTime = profiler->getFrameTime();
+        for (int i = 0; i < NumberOfZones; i++)
+        {
+            record->zones[i] = profiler->getPreviousFrame((Zone)i);
+        }
+        record->ticks = ticks;
+        record->balls = balls;
+        record->tickLatency = latency->tick;
+        record->presentLatency = latency->present;
+        head.store(next + 1, std::memory_order_release);
+
+        if (queued + 1 == TELEMETRY_CAPACITY / 2)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            drainRequested = true;
+            wake.notify_one();
+        }
+    }
+
+    // Blocks until every frame recorded so far has been written and flushed.
+    void flush()
+    {
+        if (!file)
+        {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t request = ++flushRequests;
+        wake.notify_one();
+        flushed.wait(lock, [this, request]() { return flushesDone >= request; });
+    }
+
+    // How a render loop scheduled its frames; scene names it. Defined in
+    // scheduler.h, next to ScheduleReport.
+    inline void schedule(const char *scene, const ScheduleReport *report);
+
+    // One report window of a netplay peer; role is "server", "left" or
+    // "right". Defined in netplay.h, next to NetReport.
+    inline void net(const char *role, const NetReport *report);
+
+    // Stops the writer and ends the session with totals and percentiles
+    // from profiler (skipped when it is NULL).
+    void close(const Profiler *profiler, double executionTime)
+    {
+        if (!file)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_one();
+        writer.join();
+
+        fprintf(file,
+                "{\"type\": \"session\", \"event\": \"end\", \"session\": %llu, \"execution_s\": %.3f, "
+                "\"frames\": %llu, \"dropped\": %llu",
+                session.id, executionTime, (unsigned long long)frames, (unsigned long long)dropped.load());
+        if (presentLatency.getCount())
+        {
+            fprintf(file,
+                    ", \"tick_latency_p50_ns\": %llu, \"tick_latency_p99_ns\": %llu, \"tick_latency_max_ns\": %llu"
+                    ", \"present_latency_p50_ns\": %llu, \"present_latency_p99_ns\": %llu, \"present_latency_max_ns\": %llu",
+                    (unsigned long long)tickLatency.percentile(0.50), (unsigned long long)tickLatency.percentile(0.99),
+                    (unsigned long long)tickLatency.getMax(), (unsigned long long)presentLatency.percentile(0.50),
+                    (unsigned long long)presentLatency.percentile(0.99), (unsigned long long)presentLatency.getMax());
+        }
+        if (profiler)
+        {
+            const Histogram &frameHistogram = profiler->getFrameHistogram();
+            fprintf(file, ", \"frame_p50_ns\": %llu, \"frame_p99_ns\": %llu, \"frame_max_ns\": %llu",
+                    (unsigned long long)frameHistogram.percentile(0.50),
+                    (unsigned long long)frameHistogram.percentile(0.99),
+                    (unsigned long long)frameHistogram.getMax());
+            for (int i = 0; i < NumberOfZones; i++)
+            {
+                const Histogram &histogram = profiler->getHistogram((Zone)i);
+                fprintf(file,
+                        ", \"%s_calls\": %llu, \"%s_total_ns\": %llu, \"%s_p50_ns\": %llu, \"%s_p99_ns\": %llu, \"%s_max_ns\": %llu",
+                        zoneName((Zone)i), (unsigned long long)profiler->getCalls((Zone)i),
+                        zoneName((Zone)i), (unsigned long long)profiler->getTotal((Zone)i),
+                        zoneName((Zone)i), (unsigned long long)histogram.percentile(0.50),
+                        zoneName((Zone)i), (unsigned long long)histogram.percentile(0.99),
+                        zoneName((Zone)i), (unsigned long long)histogram.getMax());
+            }
+        }
+        fputs("}\n", file);
+        fclose(file);
+        file = NULL;
+    }
+};
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include <string.h>
+#include "raylib.h"
+#include "rlgl.h"
+#include "uitext.h"
+
+// All HUD and menu text through one glyph atlas and one quad batch. The
+// atlas is raylib's default font texture; its source rectangle and advance
+// for every character are looked up once, so laying out a string is a
+// table walk instead of a glyph search per character, and comes out at the
+// same pixels as DrawText. draw() only adds quads; flush() sends every quad
+// since the last flush as one rlgl batch on one texture, so text goes on top
+// of whatever was drawn before the flush and costs about the same for one
+// label as for fifty. Widths are cached per (string, size) in an open
+// addressed table, so centering a title every frame does not measure it
+// every frame. Text is one line of ASCII; other bytes draw as the font's
+// '?'. Until the window is up, and with a font raylib did not load,
+// everything falls back to DrawText and MeasureText.
+
+#define TEXT_GLYPHS 128
+#define TEXT_QUADS 2048
+#define MEASURE_CACHE 256
+#define MEASURE_PROBES 8
+
+//TEXT RENDERER CLASS
+class TextRenderer
+{
+private:
+    typedef struct Glyph
+    {
+        Rectangle source;
+        float offsetX;
+        float offsetY;
+        float advance;
+    } Glyph;
+
+    typedef struct Quad
+    {
+        float x;
+        float y;
+        float width;
+        float height;
+        float u0;
+        float v0;
+        float u1;
+        float v1;
+        Color color;
+    } Quad;
+
+    // text is a copy, so a hit never depends on who owned the string.
+    typedef struct Measured
+    {
+        unsigned hash;
+        int fontSize;
+        int length;
+        int width;
+        char text[TEXT_RUN];
+    } Measured;
+
+    Glyph glyphs[TEXT_GLYPHS];
+    unsigned int texture;
+    float textureWidth;
+    float textureHeight;
+    float baseSize;
+    bool loaded;
+    bool tried;
+
+    Quad quads[TEXT_QUADS];
+    int count;
+
+    Measured measured[MEASURE_CACHE];
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t batches;
+
+    // raylib's default font loads with the window.
+    bool ready()
+    {
+        if (!tried && IsWindowReady())
+        {
+            load(GetFontDefault());
+        }
+        return loaded;
+    }
+
+    // DrawText's size and spacing rules for the default font.
+    static int clampSize(int fontSize)
+    {
+        return fontSize < 10 ? 10 : fontSize;
+    }
+
+    const Glyph *glyph(unsigned char character)
+    {
+        return &glyphs[character < TEXT_GLYPHS ? character : '?'];
+    }
+
+    int layoutWidth(const char *text, int length, int fontSize)
+    {
+        float scale = fontSize / baseSize;
+        int spacing = fontSize / 10;
+        float width = 0;
+        for (int i = 0; i < length; i++)
+        {
+            width += glyph((unsigned char)text[i])->advance;
+        }
+        return length > 0 ? (int)(width * scale + (length - 1) * spacing) : 0;
+    }
+
+    static unsigned hashText(const char *text, int length, int fontSize)
+    {
+        unsigned key = 2166136261u ^ (unsigned)fontSize;
+        for (int i = 0; i < length; i++)
+        {
+            key = (key ^ (unsigned char)text[i]) * 16777619u;
+        }
+        return key;
+    }
+
+public:
+    TextRenderer() : texture(0), textureWidth(1), textureHeight(1), baseSize(10), loaded(false), tried(false),
+                     count(0), hits(0), misses(0), batches(0)
+    {
+        memset(measured, 0, sizeof(measured));
+    }
+
+    TextRenderer(const TextRenderer &) = delete;
+    TextRenderer &operator=(const TextRenderer &) = delete;
+
+    // Builds the glyph table from font, which stays owned by raylib. Called
+    // by the first draw or measure once the window is up.
+    void load(Font font)
+    {
+        tried = true;
+        loaded = false;
+        if (font.glyphCount <= 0 || font.recs == NULL || font.glyphs == NULL || font.texture.id == 0)
+        {
+            return;
+        }
+        texture = font.texture.id;
+        textureWidth = (float)font.texture.width;
+        textureHeight = (float)font.texture.height;
+        baseSize = (float)font.baseSize;
+        float padding = (float)font.glyphPadding;
+        for (int c = 0; c < TEXT_GLYPHS; c++)
+        {
+            int index = GetGlyphIndex(font, c >= 32 && c < 127 ? c : '?');
+            Rectangle rectangle = font.recs[index];
+            GlyphInfo info = font.glyphs[index];
+            glyphs[c].source = Rectangle{rectangle.x - padding, rectangle.y - padding,
+                                         rectangle.width + 2 * padding, rectangle.height + 2 * padding};
+            glyphs[c].offsetX = info.offsetX - padding;
+            glyphs[c].offsetY = info.offsetY - padding;
+            glyphs[c].advance = info.advanceX != 0 ? (float)info.advanceX : rectangle.width + info.offsetX;
+        }
+        memset(measured, 0, sizeof(measured));
+        loaded = true;
+    }
+
+    // The width MeasureText would give.
+    int measure(const char *text, int length, int fontSize)
+    {
+        if (!ready())
+        {
+            return MeasureText(text, fontSize);
+        }
+        fontSize = clampSize(fontSize);
+        if (length >= TEXT_RUN)
+        {
+            misses++;
+            return layoutWidth(text, length, fontSize);
+        }
+
+        unsigned hash = hashText(text, length, fontSize);
+        Measured *slot = NULL;
+        for (int probe = 0; probe < MEASURE_PROBES; probe++)
+        {
+            Measured *entry = &measured[(hash + probe) & (MEASURE_CACHE - 1)];
+            if (entry->fontSize == 0)
+            {
+                slot = entry;
+                break;
+            }
+            if (entry->hash == hash && entry->fontSize == fontSize && entry->length == length &&
+                !memcmp(entry->text, text, length))
+            {
+                hits++;
+                return entry->width;
+            }
+        }
+
+        // A full probe sequence gives its first entry to the new string
+        misses++;
+        slot = slot ? slot : &measured[hash & (MEASURE_CACHE - 1)];
+        slot->hash = hash;
+        slot->fontSize = fontSize;
+        slot->length = length;
+        slot->width = layoutWidth(text, length, fontSize);
+        memcpy(slot->text, text, length);
+        slot->text[length] = '\0';
+        return slot->width;
+    }
+
+    int measure(const char *text, int fontSize)
+    {
+        return measure(text, (int)strlen(text), fontSize);
+    }
+
+    int measure(TextView text, int fontSize)
+    {
+        return measure(text.text, text.length, fontSize);
+    }
+
+    // Queues text with its top left corner at (x, y), for the next flush().
+    void draw(const char *text, int length, int x, int y, int fontSize, Color color)
+    {
+        if (!ready())
+        {
+            DrawText(text, x, y, fontSize, color);
+            return;
+        }
+        fontSize = clampSize(fontSize);
+        float scale = fontSize / baseSize;
+        int spacing = fontSize / 10;
+        float penX = (float)x;
+        for (int i = 0; i < length; i++)
+        {
+            const Glyph *g = glyph((unsigned char)text[i]);
+            if (text[i] != ' ' && text[i] != '\t')
+            {
+                if (count == TEXT_QUADS)
+                {
+                    flush();
+                }
+                Quad *quad = &quads[count++];
+                quad->x = penX + g->offsetX * scale;
+                quad->y = y + g->offsetY * scale;
+                quad->width = g->source.width * scale;
+                quad->height = g->source.height * scale;
+                quad->u0 = g->source.x / textureWidth;
+                quad->v0 = g->source.y / textureHeight;
+                quad->u1 = (g->source.x + g->source.width) / textureWidth;
+                quad->v1 = (g->source.y + g->source.height) / textureHeight;
+                quad->color = color;
+            }
+            penX += g->advance * scale + spacing;
+        }
+    }
+
+    void draw(const char *text, int x, int y, int fontSize, Color color)
+    {
+        draw(text, (int)strlen(text), x, y, fontSize, color);
+    }
+
+    void draw(TextView text, int x, int y, int fontSize, Color color)
+    {
+        draw(text.text, text.length, x, y, fontSize, color);
+    }
+
+    // Queues text centered on centerX, with its top at y.
+    void drawCentered(TextView text, int centerX, int y, int fontSize, Color color)
+    {
+        draw(text.text, text.length, centerX - measure(text, fontSize) / 2, y, fontSize, color);
+    }
+
+    void drawCentered(const char *text, int centerX, int y, int fontSize, Color color)
+    {
+        drawCentered(TextView{text, (int)strlen(text)}, centerX, y, fontSize, color);
+    }
+
+    // Sends the queued quads as one batch; call it before EndDrawing() or
+    // the end of the texture or scissor mode the text belongs to.
+    void flush()
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        rlCheckRenderBatchLimit(count * 4);
+        rlSetTexture(texture);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0, 0, 1);
+        for (int i = 0; i < count; i++)
+        {
+            const Quad *quad = &quads[i];
+            rlColor4ub(quad->color.r, quad->color.g, quad->color.b, quad->color.a);
+            rlTexCoord2f(quad->u0, quad->v0);
+            rlVertex2f(quad->x, quad->y);
+            rlTexCoord2f(quad->u0, quad->v1);
+            rlVertex2f(quad->x, quad->y + quad->height);
+            rlTexCoord2f(quad->u1, quad->v1);
+            rlVertex2f(quad->x + quad->width, quad->y + quad->height);
+            rlTexCoord2f(quad->u1, quad->v0);
+            rlVertex2f(quad->x + quad->width, quad->y);
+        }
+        rlEnd();
+        rlSetTexture(0);
+        count = 0;
+        batches++;
+    }
+
+    uint64_t getHits()
+    {
+        return hits;
+    }
+
+    uint64_t getMisses()
+    {
+        return misses;
+    }
+
+    uint64_t getBatches()
+    {
+        return batches;
+    }
+};
+
+inline TextRenderer textRenderer;
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Work-stealing parallel for over [0, count). Every worker starts with an
+// equal slice of the index range, takes indices from the front of its own
+// slice and, once it runs dry, steals the back half of another worker's.
+// A slice is a single 64-bit word (begin | end << 32) updated with CAS, so
+// neither taking nor stealing needs a lock. Tasks get their worker number so
+// they can keep per-thread accumulators and merge them afterwards.
+
+//THREAD POOL CLASS
+class ThreadPool
+{
+private:
+    struct alignas(64) Slice
+    {
+        std::atomic<uint64_t> bounds;
+    };
+
+    int threads;
+    std::vector<Slice> slices;
+
+    static uint64_t pack(uint32_t begin, uint32_t end)
+    {
+        return (uint64_t)begin | ((uint64_t)end << 32);
+    }
+
+    static uint32_t begin(uint64_t bounds)
+    {
+        return (uint32_t)bounds;
+    }
+
+    static uint32_t end(uint64_t bounds)
+    {
+        return (uint32_t)(bounds >> 32);
+    }
+
+    bool take(int worker, uint32_t *index)
+    {
+        std::atomic<uint64_t> &bounds = slices[worker].bounds;
+        uint64_t current = bounds.load(std::memory_order_acquire);
+        while (begin(current) < end(current))
+        {
+            if (bounds.compare_exchange_weak(current, pack(begin(current) + 1, end(current)),
+                                             std::memory_order_acq_rel))
+            {
+                *index = begin(current);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool steal(int worker)
+    {
+        for (int offset = 1; offset < threads; offset++)
+        {
+            std::atomic<uint64_t> &victim = slices[(worker + offset) % threads].bounds;
+            uint64_t current = victim.load(std::memory_order_acquire);
+            while (begin(current) < end(current))
+            {
+                uint32_t half = (end(current) - begin(current) + 1) / 2;
+                uint32_t split = end(current) - half;
+                if (victim.compare_exchange_weak(current, pack(begin(current), split),
+                                                 std::memory_order_acq_rel))
+                {
+                    // Our own slice is empty, so nobody else writes it until this store
+                    slices[worker].bounds.store(pack(split, end(current)), std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <typename Task>
+    void work(int worker, Task &task)
+    {
+        uint32_t index;
+        do
+        {
+            while (take(worker, &index))
+            {
+                task(index, worker);
+            }
+        } while (steal(worker));
+    }
+
+public:
+    ThreadPool(int threadCount) : threads(threadCount > 0 ? threadCount : 1), slices(threads) {}
+
+    int getThreads()
+    {
+        return threads;
+    }
+
+    // task(index, worker) is called exactly once for every index < count.
+    // count must fit in 32 bits.
+    template <typename Task>
+    void parallelFor(uint32_t count, Task task)
+    {
+        for (int i = 0; i < threads; i++)
+        {
+            uint32_t first = (uint32_t)((uint64_t)count * i / threads);
+            uint32_t last = (uint32_t)((uint64_t)count * (i + 1) / threads);
+            slices[i].bounds.store(pack(first, last), std::memory_order_relaxed);
+        }
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; i++)
+        {
+            workers.emplace_back([this, i, &task]() { work(i, task); });
+        }
+        work(0, task);
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i].join();
+        }
+    }
+};
+
+#endif
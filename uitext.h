@@ -0,0 +1,182 @@
+#ifndef UITEXT_H
+#define UITEXT_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// UI text without the heap. Widgets hand out TextViews of their own fixed
+// buffers instead of copies. Text that only lives for one frame, like a
+// masked password, is built in frameArena, which the game resets at the
+// start of every frame (see beginDrawing() in game.cpp). Text that changes
+// rarely, like names and scores, is kept in a TextRun that is only
+// formatted again when its value changes. Built with
+// -DPONG_COUNT_ALLOCATIONS, game.cpp counts every heap allocation in
+// heapAllocations and reports any frame past the first second that made
+// one.
+
+#define FRAME_ARENA (16 * 1024)
+#define TEXT_RUN 32
+
+//STRUCTURS
+// Characters owned by someone else, valid as long as the owner; text is
+// always NUL terminated for raylib.
+typedef struct TextView
+{
+    const char *text;
+    int length;
+} TextView;
+
+// Heap allocations so far; only counted with PONG_COUNT_ALLOCATIONS.
+inline std::atomic<uint64_t> heapAllocations(0);
+
+//FRAME ARENA CLASS
+// A bump allocator over a fixed buffer. When a frame runs out of room the
+// text is cut short and counted in overflows; it never falls back to the heap.
+class FrameArena
+{
+private:
+    char buffer[FRAME_ARENA];
+    int used;
+    int peak;
+    uint64_t overflows;
+
+    static TextView empty()
+    {
+        return TextView{"", 0};
+    }
+
+    void commit(int size)
+    {
+        used += size;
+        peak = used > peak ? used : peak;
+    }
+
+public:
+    FrameArena() : used(0), peak(0), overflows(0) {}
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // Everything handed out since the last reset() is gone.
+    void reset()
+    {
+        used = 0;
+    }
+
+    TextView format(const char *format, ...)
+    {
+        int room = FRAME_ARENA - used;
+        if (room <= 1)
+        {
+            overflows++;
+            return empty();
+        }
+        va_list arguments;
+        va_start(arguments, format);
+        int length = vsnprintf(buffer + used, room, format, arguments);
+        va_end(arguments);
+        if (length < 0)
+        {
+            return empty();
+        }
+        if (length >= room)
+        {
+            overflows++;
+            length = room - 1;
+        }
+        TextView view = {buffer + used, length};
+        commit(length + 1);
+        return view;
+    }
+
+    // count copies of character, as for a masked password.
+    TextView repeat(char character, int count)
+    {
+        int room = FRAME_ARENA - used;
+        if (count >= room)
+        {
+            overflows++;
+            count = room - 1;
+        }
+        if (count < 0)
+        {
+            return empty();
+        }
+        char *text = buffer + used;
+        memset(text, character, count);
+        text[count] = '\0';
+        commit(count + 1);
+        return TextView{text, count};
+    }
+
+    int getUsed()
+    {
+        return used;
+    }
+
+    // The most one frame has used.
+    int getPeak()
+    {
+        return peak;
+    }
+
+    uint64_t getOverflows()
+    {
+        return overflows;
+    }
+};
+
+inline FrameArena frameArena;
+
+//TEXT RUN CLASS
+// Text that is only formatted again when what it shows changes.
+class TextRun
+{
+private:
+    char text[TEXT_RUN];
+    int length;
+    int number;
+    bool isNumber;
+
+public:
+    TextRun() : length(0), number(0), isNumber(false)
+    {
+        text[0] = '\0';
+    }
+
+    // Returns whether the text changed.
+    bool setNumber(int value)
+    {
+        if (isNumber && value == number)
+        {
+            return false;
+        }
+        number = value;
+        isNumber = true;
+        length = snprintf(text, sizeof(text), "%d", value);
+        return true;
+    }
+
+    bool setText(const char *value)
+    {
+        if (!isNumber && !strncmp(text, value, sizeof(text) - 1))
+        {
+            return false;
+        }
+        isNumber = false;
+        strncpy(text, value, sizeof(text) - 1);
+        text[sizeof(text) - 1] = '\0';
+        length = (int)strlen(text);
+        return true;
+    }
+
+    TextView view()
+    {
+        return TextView{text, length};
+    }
+};
+
+#endif